@@ -17,6 +17,12 @@ Block::Block(const Block& other) {
     tag = other.tag, index = other.index;
     n = (1 << (B-K));
     dirty = other.dirty;
+    prefetched = other.prefetched;
+    owner = other.owner;
+    last_use = other.last_use;
+    pc = other.pc;
+    reused = other.reused;
+    predicted_dead = other.predicted_dead;
     valid = other.valid;
 }
 
@@ -25,6 +31,12 @@ Block& Block::operator=(const Block& other) {
     tag = other.tag, index = other.index;
     n = (1 << (B-K));
     dirty = other.dirty;
+    prefetched = other.prefetched;
+    owner = other.owner;
+    last_use = other.last_use;
+    pc = other.pc;
+    reused = other.reused;
+    predicted_dead = other.predicted_dead;
     valid = other.valid;
     return *this;
 }
@@ -83,6 +95,7 @@ void Block::replace(u64 tag, u64 index, bool full) {
     this->tag = tag;
     this->index = index;
     this->dirty = false; 
+    this->prefetched = false;
 
     // Full block replace => all valid
     if (full)
@@ -114,7 +127,12 @@ int Block::num_invalid(u64 offset) {
 }
 
 int Block::find_idx(u64 offset) {
+    return subblock_index(offset, B, K);
+}
+
+int subblock_index(u64 offset, u64 B, u64 K) {
      // Figure out which subblock is being requested
+    int n = (1 << (B-K));
     float max_offset = (1 << B) - 1;
     float ratio = offset / max_offset;
     int idx = static_cast<int>(ratio * n);
@@ -124,3 +142,21 @@ int Block::find_idx(u64 offset) {
 
     return idx;
 }
+
+void Block::save_state(std::vector<u64>& out) const {
+    out.push_back(tag);
+    out.push_back(index);
+    out.push_back((dirty ? 1 : 0) | (prefetched ? 2 : 0));
+
+    // Valid bits, 64 per word
+    u64 word = 0;
+
+    for (int i = 0; i < n; i++) {
+        word |= static_cast<u64>(valid[i] != 0) << (i % 64);
+
+        if (i % 64 == 63 || i == n - 1) {
+            out.push_back(word);
+            word = 0;
+        }
+    }
+}
@@ -5,6 +5,9 @@
 
 #include "cachesim.hpp"
 
+// Subblock holding byte `offset` of a 2^B-byte block with 2^K-byte subblocks
+int subblock_index(u64 offset, u64 B, u64 K);
+
 /**
     Represents a single block in a cache.
 */
@@ -14,6 +17,14 @@ public:
     std::vector<int> valid;
     u64 tag = 0, index = 0;
     bool dirty = false;
+    bool prefetched = false; // Filled by a prefetch, not yet used
+    int owner = 0;           // Program that filled it (shared-cache mode)
+    u64 last_use = 0;        // Time of last access (skewed caches)
+
+    // PC-aware replacement (see replacement.hpp)
+    uint32_t pc = 0;             // PC that filled (SHiP) or last touched (DBP) it
+    bool reused = false;         // Hit since the fill
+    bool predicted_dead = false;
     
     int n; // Number of subblocks
     u64 B; // Block size
@@ -46,6 +57,9 @@ public:
 
     // Find subblock idx given an offset
     int find_idx(u64 offset);
+
+    // Append the state that decides future behavior (see Cache::save_state())
+    void save_state(std::vector<u64>& out) const;
 };
 
 #endif
@@ -1,4 +1,5 @@
 // C++ includes
+#include <algorithm>
 #include <iostream>
 
 #include "cache.hpp"
@@ -15,6 +16,31 @@ CacheType find_cache_type(CacheSize size) {
     }
 }
 
+double cache_hit_time(CacheSize size) {
+    return 2 + 0.1 * (1 << size.S);
+}
+
+u64 cache_storage_bits(CacheSize size) {
+    u64 blocks = static_cast<u64>(1) << (size.C - size.B);
+    u64 subblocks = static_cast<u64>(1) << (size.B - size.K);
+    u64 data = static_cast<u64>(8) << size.B;
+
+    // Tag covers whatever the index and offset do not
+    u64 tag = ADDR_BITS - (size.C - size.B - size.S) - size.B;
+    u64 per_block = data + tag + subblocks + 1;
+
+    // VC is fully associative: tag is the whole block address
+    u64 vc_tag = ADDR_BITS - size.B;
+    u64 per_vc_block = data + vc_tag + subblocks + 1;
+
+    return blocks * per_block + size.V * per_vc_block;
+}
+
+u64 Cache::effective_misses() {
+    u64 misses = vc ? stats->vc_misses : stats->read_misses + stats->write_misses;
+    return misses + stats->subblock_misses - stats->stream_hits - stats->write_bypasses;
+}
+
 void Cache::compute_stats() {
     stats->misses = stats->read_misses + stats->write_misses;
 
@@ -29,7 +55,57 @@ void Cache::compute_stats() {
         stats->miss_rate = static_cast<double>(stats->misses + stats->subblock_misses) / stats->accesses;
     }
 
+    // Misses served by a stream buffer cost a hit, not a memory access
+    if (stats->stream_hits > 0)
+        stats->miss_rate -= static_cast<double>(stats->stream_hits) / stats->accesses;
+
+    // Bypassed writes never wait for a fill; their cost is in the write stalls
+    if (stats->write_bypasses > 0)
+        stats->miss_rate -= static_cast<double>(stats->write_bypasses) / stats->accesses;
+
+    // Miss penalty measured by the memory model
+    if (memory != nullptr && stats->mem_reads > 0)
+        stats->miss_penalty = stats->miss_cycles / stats->mem_reads;
+
     stats->avg_access_time = stats->hit_time + stats->miss_rate * stats->miss_penalty;
+
+    if (!set_fills.empty()) {
+        // How evenly the index function spreads fills over the sets
+        u64 total = 0, busiest = 0;
+
+        stats->sets_used = 0;
+
+        for (u64 fills: set_fills) {
+            total += fills;
+            busiest = std::max(busiest, fills);
+
+            if (fills > 0)
+                stats->sets_used++;
+        }
+
+        if (total > 0)
+            stats->set_fill_imbalance = busiest / (static_cast<double>(total) / index_sets);
+    }
+
+    if (stats->write_stall_cycles > 0)
+        stats->avg_access_time += stats->write_stall_cycles / stats->accesses;
+
+    if (wbuf != nullptr) {
+        u64 buffered = stats->wbuf_writes + stats->wbuf_coalesced;
+
+        stats->wbuf_occupancy = static_cast<double>(stats->wbuf_occupancy_sum) / stats->accesses;
+        if (buffered > 0)
+            stats->wbuf_coalesce_rate = static_cast<double>(stats->wbuf_coalesced) / buffered;
+    }
+
+    if (stats->prefetches > 0) {
+        // Demand misses the prefetcher did not cover
+        u64 remaining = vc ? stats->vc_misses : stats->misses;
+        remaining += stats->subblock_misses - stats->stream_hits;
+
+        stats->prefetch_accuracy = static_cast<double>(stats->prefetch_hits) / stats->prefetches;
+        stats->prefetch_coverage = static_cast<double>(stats->prefetch_hits) / (stats->prefetch_hits + remaining);
+    }
 }
 
 Cache::Cache(CacheSize size, CacheType ct, cache_stats_t* cs) :
@@ -77,7 +153,7 @@ Cache::Cache(CacheSize size, CacheType ct, cache_stats_t* cs) :
     }
 
     // Init LRU
-    int max_size;
+    int max_size = 0; // Direct-mapped caches have no LRU
 
     if (ct == FULLY_ASSOC)
         max_size = rows;
@@ -93,6 +169,7 @@ Cache::Cache(CacheSize size, CacheType ct, cache_stats_t* cs) :
     if (V > 0) {
         this->victim_cache = new VictimCache(V);
         this->vc = true;
+        this->spill = new Block(B, K, sb);
     }
 
     #if DEBUG
@@ -112,14 +189,96 @@ Cache::Cache(CacheSize size, CacheType ct, cache_stats_t* cs) :
         std::cout << "Cache type: " << t << std::endl;
     #endif
 
-    stats->hit_time = 2 + 0.1 * (1 << S);
+    stats->hit_time = cache_hit_time(size);
     stats->miss_penalty = 100;
 }
 
 Cache::~Cache() {
     // Free up VC
-    if (this->vc)
+    if (this->vc) {
         delete this->victim_cache;
+        delete this->spill;
+    }
+
+    delete this->wbuf;
+}
+
+void Cache::set_prefetcher(Prefetcher* pf) {
+    prefetcher = pf;
+
+    if (pf != nullptr)
+        pf->attach(size.B, stats);
+}
+
+void Cache::set_write_config(const WriteConfig& wc) {
+    write_policy = wc.policy;
+
+    delete wbuf;
+    wbuf = nullptr;
+
+    if (wc.buffer > 0)
+        wbuf = new WriteBuffer(wc.buffer, wc.drain, size.B, size.K, stats);
+
+    timed = (wbuf != nullptr || memory != nullptr);
+}
+
+void Cache::set_memory(MemoryBackend* mem) {
+    memory = mem;
+
+    if (mem != nullptr)
+        mem->attach(stats);
+
+    timed = (wbuf != nullptr || memory != nullptr);
+}
+
+void Cache::set_replacement(ReplacementPredictor* rp) {
+    if (rp != nullptr && ct == DIRECT_MAPPED)
+        exit_on_error("PC-aware replacement needs an associative cache.");
+
+    replacement = rp;
+}
+
+void Cache::predict_fill(Block* block, u64 tag, u64 index) {
+    if (replacement->fill(block, cur_pc))
+        demote(block, tag, index);
+}
+
+void Cache::predict_hit(Block* block, u64 tag, u64 index) {
+    if (block->predicted_dead) {
+        block->predicted_dead = false;
+        stats->dead_mispredictions++;
+    }
+
+    bool dead = replacement->hit(block, cur_pc);
+    block->reused = true;
+
+    if (dead)
+        demote(block, tag, index);
+}
+
+void Cache::demote(Block* block, u64 tag, u64 index) {
+    stats->predicted_dead++;
+    block->predicted_dead = true;
+
+    if (indexing == INDEX_SKEW)
+        block->last_use = 0;
+    else
+        lru[(ct == FULLY_ASSOC) ? 0 : index]->demote(tag);
+}
+
+void Cache::fetch(u64 addr) {
+    if (memory == nullptr) {
+        // Blocking cache, fixed penalty
+        fetch_stall += stats->miss_penalty;
+        return;
+    }
+
+    double stall;
+    double latency = memory->read(addr & ~offset_mask, cycle, stall);
+
+    stats->mem_reads++;
+    stats->miss_cycles += latency;
+    fetch_stall += stall;
 }
 
 Block* Cache::find_block(const u64 tag, const u64 index) {
@@ -136,6 +295,18 @@ Block* Cache::find_block(const u64 tag, const u64 index) {
                 break;
             }
         }
+    } else if (indexing == INDEX_SKEW) {
+        // Way w holds the block in its own hashed set
+        u64 b = tag >> size.B;
+
+        for (int w = 0; w < cols; w++) {
+            Block* candidate = &cache[hashed_index(b, w)][w];
+
+            if (candidate->tag == tag) {
+                block = candidate;
+                break;
+            }
+        }
     } else if (ct == DIRECT_MAPPED) {
         // Retrieve the "only" possible block
         block = &cache[index][0];
@@ -177,10 +348,16 @@ Block* Cache::check_vc(const u64 addr) {
             // Note: ptr is TEMPORARY
             Block *target = victim_cache->remove(pos);
 
+            if (cur_set != nullptr)
+                cur_set->vc_hits++;
+
             // Perform eviction and copy block back to cache
             block = evict(tag, index);
             *block = *target;
 
+            // The copy brings the stamp it had when it left; it is MRU now
+            block->last_use = ++use_clock;
+
             // Now cpied into cache, so delete
             delete target;
 
@@ -189,6 +366,7 @@ Block* Cache::check_vc(const u64 addr) {
                 stats->bytes_transferred += block->num_invalid(offset);;
                 block->write_many(offset);
                 stats->subblock_misses++;
+                fetch(addr);
             }
         } else {
             // VC miss
@@ -199,16 +377,14 @@ Block* Cache::check_vc(const u64 addr) {
     return block;
 }
 
-CacheResult Cache::read(u64 addr) {
-    const u64 tag = get_tag(addr);
-    const u64 index = get_index(addr);
-    const u64 offset = get_offset(addr);
-
+CacheResult Cache::read(u64 addr, u64 tag, u64 index, u64 offset) {
     // Add access to LRU
     lru_push(tag, index);
 
     stats->accesses++;
     stats->reads++;
+    fetch_stall = 0;
+    count_access(index);
 
     auto block = find_block(tag, index);
     bool hit = false;
@@ -217,8 +393,19 @@ CacheResult Cache::read(u64 addr) {
         hit = true;
 
     CacheResult cr;
+    bool pf_hit = false;
 
     if (hit) {
+        if (replacement != nullptr)
+            predict_hit(block, tag, index);
+
+        // First demand use of a prefetched block
+        if (block->prefetched) {
+            block->prefetched = false;
+            stats->prefetch_hits++;
+            pf_hit = true;
+        }
+
         // Subblock hit
         if (block->read(offset))
             cr = READ_HIT;
@@ -229,6 +416,7 @@ CacheResult Cache::read(u64 addr) {
             block->write_many(offset);
 
             stats->subblock_misses++;
+            fetch(addr);
         
             cr = READ_SB_MISS;
         }
@@ -236,10 +424,17 @@ CacheResult Cache::read(u64 addr) {
         // Full read miss
         stats->read_misses++;
 
+        if (cur_set != nullptr)
+            cur_set->misses++;
+
         // Check the VC first
         // If hit, handle it within check_vc
         block = check_vc(addr);
 
+        // Then any stream buffers
+        if (block == nullptr && prefetcher != nullptr)
+            block = check_stream(addr);
+
         // VC miss
         if (block == nullptr) {
             // Find suitable victim to evict
@@ -247,10 +442,14 @@ CacheResult Cache::read(u64 addr) {
             // Note: *only* if not already found
             block = evict(tag, index);
 
+            if (replacement != nullptr)
+                predict_fill(block, tag, index);
+
             // Retrieve subblock and prefetch subsequent
             // Fetch required subblocks from memory
             int bytes = block->write_many(offset);
             stats->bytes_transferred += bytes;
+            fetch(addr);
 
             if (vc) {
                 // Missed both cache and VC
@@ -261,18 +460,20 @@ CacheResult Cache::read(u64 addr) {
         cr = READ_MISS;
     }
 
-    return cr;
-}
+    if (prefetcher != nullptr)
+        run_prefetcher(addr, cr == READ_MISS || pf_hit);
 
-CacheResult Cache::write(u64 addr) {
-    const u64 tag = get_tag(addr);
-    const u64 index = get_index(addr);
-    const u64 offset = get_offset(addr);
+    if (timed)
+        tick();
 
-    lru_push(tag, index);
+    return cr;
+}
 
+CacheResult Cache::write(u64 addr, u64 tag, u64 index, u64 offset) {
     stats->accesses++;
     stats->writes++;
+    fetch_stall = 0;
+    count_access(index);
 
     // Find block in cache
     // If not present, = nullptr
@@ -282,9 +483,27 @@ CacheResult Cache::write(u64 addr) {
     if (block != nullptr)
         hit = true;
 
+    // No-write-allocate: a write missing both cache and VC goes around them
+    if (!hit && write_policy == WRITE_NO_ALLOCATE &&
+            !(vc && victim_cache->lookup(tag, index) != -1))
+        return write_around(addr);
+
+    lru_push(tag, index);
+
     CacheResult cr;
+    bool pf_hit = false;
 
     if (hit) {
+        if (replacement != nullptr)
+            predict_hit(block, tag, index);
+
+        // First demand use of a prefetched block
+        if (block->prefetched) {
+            block->prefetched = false;
+            stats->prefetch_hits++;
+            pf_hit = true;
+        }
+
         if (block->read(offset)) {
             cr = WRITE_HIT;
         } else {
@@ -297,15 +516,25 @@ CacheResult Cache::write(u64 addr) {
         // Full write miss
         stats->write_misses++;
 
+        if (cur_set != nullptr)
+            cur_set->misses++;
+
         // Check the VC first
         block = check_vc(addr);
 
+        // Then any stream buffers
+        if (block == nullptr && prefetcher != nullptr)
+            block = check_stream(addr);
+
         if (block == nullptr) {
             // Find suitable victim to evict
             // Or return first empty block
             // Note: *only* if not already found
             block = evict(tag, index);
 
+            if (replacement != nullptr)
+                predict_fill(block, tag, index);
+
             if (vc) {
                 // Missed both cache and VC
                 stats->write_misses_combined++;
@@ -316,46 +545,370 @@ CacheResult Cache::write(u64 addr) {
     }
 
     // Write invalid subblocks needed into block in cache
-    stats->bytes_transferred += block->num_invalid(offset);
-    block->write_many(offset);
+    // (no-write-allocate writes around a missing subblock instead)
+    if (cr != WRITE_SB_MISS || write_policy != WRITE_NO_ALLOCATE) {
+        int bytes = block->num_invalid(offset);
+        stats->bytes_transferred += bytes;
+        block->write_many(offset);
+
+        if (bytes > 0)
+            fetch(addr);
+    }
+
+    if (write_policy == WRITE_BACK) {
+        // Always set as dirty
+        block->dirty = true;
+    } else {
+        write_through(addr);
+    }
+
+    if (prefetcher != nullptr)
+        run_prefetcher(addr, cr == WRITE_MISS || pf_hit);
 
-    // Always set as dirty
-    block->dirty = true;
+    if (timed)
+        tick();
 
     return cr;
 }
 
+// Plain bit indexing for a batch of contiguous addresses: a branch-free
+// mask/shift loop. The restrict pointers and a whole number of vectors
+// need no run-time checks, so it vectorizes at -O2; the rest is scalar.
+static void split_addresses(const u64* __restrict addrs, size_t n,
+                            u64 tag_mask, u64 index_mask, u64 offset_mask, u64 B,
+                            u64* __restrict tags, u64* __restrict indices, u64* __restrict offsets) {
+    size_t whole = n & ~static_cast<size_t>(3);
+
+    for (size_t i = 0; i < whole; i++) {
+        tags[i] = addrs[i] & tag_mask;
+        indices[i] = (addrs[i] & index_mask) >> B;
+        offsets[i] = addrs[i] & offset_mask;
+    }
+
+    for (size_t i = whole; i < n; i++) {
+        tags[i] = addrs[i] & tag_mask;
+        indices[i] = (addrs[i] & index_mask) >> B;
+        offsets[i] = addrs[i] & offset_mask;
+    }
+}
+
+void Cache::access_batch(const Access* batch, size_t n, const u64* addrs) {
+    if (batch_tags.size() < n) {
+        batch_addrs.resize(n);
+        batch_tags.resize(n);
+        batch_indices.resize(n);
+        batch_offsets.resize(n);
+    }
+
+    // Split the addresses first, into structure-of-arrays form
+    u64* tags = batch_tags.data();
+    u64* indices = batch_indices.data();
+    u64* offsets = batch_offsets.data();
+
+    if (indexing == INDEX_BITS) {
+        if (addrs == nullptr) {
+            u64* own = batch_addrs.data();
+
+            for (size_t i = 0; i < n; i++)
+                own[i] = batch[i].addr;
+
+            addrs = own;
+        }
+
+        split_addresses(addrs, n, tag_mask, index_mask, offset_mask, size.B, tags, indices, offsets);
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            u64 addr = batch[i].addr;
+
+            tags[i] = get_tag(addr);
+            indices[i] = get_index(addr);
+            offsets[i] = get_offset(addr);
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const Access& a = batch[i];
+
+        if (a.mode == REPEAT) {
+            repeat(repeat_reads(a), repeat_writes(a));
+            continue;
+        }
+
+        cur_pc = a.pc;
+
+        if (a.size > 1 && offsets[i] + a.size > offset_mask + 1) {
+            access_span(a);
+            continue;
+        }
+
+        last_addr = a.addr;
+        cur_end = offsets[i] + (a.size > 1 ? a.size - 1 : 0);
+
+        if (a.mode == WRITE)
+            write(a.addr, tags[i], indices[i], offsets[i]);
+        else
+            read(a.addr, tags[i], indices[i], offsets[i]);
+    }
+}
+
+CacheResult Cache::access_span(const Access& a) {
+    // Within a block only the first subblock touched can miss: fills
+    // validate everything from there to the end of the block. Writes
+    // through send every subblock touched (see cur_end).
+    CacheResult result = (a.mode == WRITE) ? WRITE_HIT : READ_HIT;
+    u64 end = a.addr + a.size;
+
+    stats->split_accesses++;
+
+    for (u64 addr = a.addr; addr < end; addr = (addr | offset_mask) + 1) {
+        last_addr = addr;
+        cur_end = get_offset(std::min(end - 1, addr | offset_mask));
+
+        CacheResult cr = (a.mode == WRITE) ? write(addr) : read(addr);
+
+        // Report the first miss, if any
+        if (result == READ_HIT || result == WRITE_HIT)
+            result = cr;
+    }
+
+    return result;
+}
+
+CacheResult Cache::repeat(u64 reads, u64 writes) {
+    // Anything that acts on hits would miss the collapsed accesses
+    if (prefetcher != nullptr || timed || write_policy != WRITE_BACK || replacement != nullptr)
+        exit_on_error("Reduced traces need a write-back LRU cache without prefetching or timing.");
+
+    stats->accesses += reads + writes;
+    stats->reads += reads;
+    stats->writes += writes;
+
+    if (!set_counts.empty())
+        home_set(last_addr).accesses += reads + writes;
+
+    if (writes == 0)
+        return READ_HIT;
+
+    // Still resident and MRU: the reducer guarantees it
+    find_block(get_tag(last_addr), get_index(last_addr))->dirty = true;
+
+    return WRITE_HIT;
+}
+
+CacheResult Cache::write_around(u64 addr) {
+    // Counts as a miss of both cache and VC, but nothing is allocated
+    stats->write_misses++;
+    stats->write_bypasses++;
+
+    if (cur_set != nullptr)
+        cur_set->misses++;
+
+    if (vc) {
+        stats->vc_misses++;
+        stats->write_misses_combined++;
+    }
+
+    write_through(addr);
+
+    if (prefetcher != nullptr)
+        run_prefetcher(addr, true);
+
+    if (timed)
+        tick();
+
+    return WRITE_MISS;
+}
+
+void Cache::write_through(u64 addr) {
+    // Every subblock the record touches in this block
+    u64 offset = get_offset(addr);
+    int first = subblock_index(offset, size.B, size.K);
+    int last = subblock_index(std::max(offset, cur_end), size.B, size.K);
+
+    stats->write_throughs += last - first + 1;
+
+    if (wbuf != nullptr) {
+        double stall = wbuf->write(addr & ~offset_mask, first, last, cycle);
+        stats->write_stall_cycles += stall;
+        cycle += stall;
+    } else {
+        // Unbuffered: the subblocks go straight to memory and the cache waits
+        double stall = stats->miss_penalty;
+
+        if (memory != nullptr)
+            stall = memory->write(addr & ~offset_mask, cycle);
+
+        stats->bytes_transferred += (last - first + 1) << size.K;
+        stats->write_stall_cycles += stall;
+        cycle += stall;
+    }
+}
+
+void Cache::write_back(Block* block) {
+    // Write back valid subblocks to memory
+    stats->write_backs++;
+
+    if (!set_counts.empty())
+        home_set(block_address(block)).write_backs++;
+
+    if (wbuf != nullptr) {
+        // Valid subblocks always form a suffix of the block
+        int first = block->n - block->num_valid() / (1 << size.K);
+        u64 block_addr = block_address(block);
+
+        double stall = wbuf->write(block_addr, first, block->n - 1, cycle);
+        stats->write_stall_cycles += stall;
+        cycle += stall;
+    } else {
+        stats->bytes_transferred += block->num_valid();
+
+        // Writebacks occupy memory but the cache does not wait for them
+        if (memory != nullptr)
+            memory->write(block_address(block), cycle);
+    }
+}
+
+void Cache::tick() {
+    // Advance time by this access, then let the buffer drain meanwhile
+    cycle += stats->hit_time + fetch_stall;
+
+    if (wbuf != nullptr) {
+        wbuf->drain(cycle);
+        wbuf->sample();
+    }
+}
+
+Block* Cache::check_stream(const u64 addr) {
+    const u64 tag = get_tag(addr);
+    const u64 index = get_index(addr);
+
+    if (!prefetcher->probe(addr & ~offset_mask))
+        return nullptr;
+
+    // Block arrives whole from the stream buffer; its fetch was already charged
+    Block* block = evict(tag, index);
+    block->replace(tag, index, true);
+
+    stats->prefetch_hits++;
+    stats->stream_hits++;
+
+    return block;
+}
+
+void Cache::run_prefetcher(u64 addr, bool trigger) {
+    prefetch_queue.clear();
+    prefetcher->observe(addr, trigger, prefetch_queue);
+
+    for (u64 a: prefetch_queue)
+        prefetch(a);
+}
+
+void Cache::prefetch(u64 addr) {
+    const u64 tag = get_tag(addr);
+    const u64 index = get_index(addr);
+
+    // Already cached (or waiting in the VC): nothing to fetch
+    if (find_block(tag, index) != nullptr)
+        return;
+
+    if (vc && victim_cache->lookup(tag, index) != -1)
+        return;
+
+    // Insert at MRU like a demand fill, but fetch the whole block
+    lru_push(tag, index);
+
+    Block* block = evict(tag, index);
+    block->replace(tag, index, true);
+    block->prefetched = true;
+
+    if (memory != nullptr)
+        memory->prefetch(addr & ~offset_mask, cycle);
+
+    stats->prefetches++;
+    stats->prefetch_bytes += (1 << size.B);
+    stats->bytes_transferred += (1 << size.B);
+}
+
 Block* Cache::evict(u64 tag, u64 index) {
     // Find a block to evict from cache (victim)
     // Returns tag = 0 if empty slot found
-    auto block = find_victim(index);
+    auto block = find_victim(tag, index);
+
+    if (!set_fills.empty())
+        set_fills[victim_set]++;
+
+    if (block->tag != 0) {
+        if (!set_counts.empty())
+            home_set(block_address(block)).evictions++;
+
+        // Interference: another program's fill pushed this block out
+        if (!program_stats.empty() && block->owner != program)
+            program_stats[block->owner]->evicted_by_others++;
+
+        if (replacement != nullptr)
+            replacement->evict(block);
+
+        if (evict_hook != nullptr)
+            evict_hook(evict_user, block_address(block), block->dirty);
+    }
+
+    // Prefetched block leaving unused: pollution
+    if (block->tag != 0 && block->prefetched) {
+        block->prefetched = false;
+        stats->prefetch_unused++;
+    }
 
     // If empty block, just ignore the eviction
     // If VC active, do not writeback now!
     if (block->tag != 0 && !vc) {
         // Replace the block in cache
         // Check if dirty first => writeback
-        if (block->dirty) {
-            // Write back valid subblocks to memory
-            int num_valid = block->num_valid();
-            stats->bytes_transferred += num_valid;
-            stats->write_backs++;
-        }
+        if (block->dirty)
+            write_back(block);
     } else if (block->tag != 0 && vc) {
         // If VC active, push evicted block to VC
-        victim_cache->push(block, stats);
+        // Writeback if the block falling out of the VC is dirty
+        if (victim_cache->push(block, *spill) && spill->dirty)
+            write_back(spill);
     }
 
     block->replace(tag, index, false);
+    block->owner = program;
+    block->last_use = ++use_clock;
+    block->pc = cur_pc;
+    block->reused = false;
+    block->predicted_dead = false;
 
     return block;
 }
 
-Block* Cache::find_victim(u64 index) {
+Block* Cache::find_victim(u64 tag, u64 index) {
     // Figure out candidate block for cache eviction
     // IF there are empty blocks, return first such one as a "victim"
     Block* block = nullptr;
     u64 victim_tag;
+
+    victim_set = index;
+
+    if (indexing == INDEX_SKEW) {
+        // One candidate per way, each in its own set; empty first, then LRU
+        u64 b = tag >> size.B;
+
+        for (int w = 0; w < cols; w++) {
+            u64 set = hashed_index(b, w);
+            Block* candidate = &cache[set][w];
+
+            if (candidate->tag == 0 || block == nullptr || candidate->last_use < block->last_use) {
+                block = candidate;
+                victim_set = set;
+            }
+
+            if (candidate->tag == 0)
+                break;
+        }
+
+        return block;
+    }
     
     if (ct == FULLY_ASSOC) {
         // Look for an empty block first 
@@ -365,6 +918,9 @@ Block* Cache::find_victim(u64 index) {
                 return block;
         }
 
+        if (!quotas.empty())
+            return partition_victim(index);
+
         // Now look for a victim
         victim_tag = lru_get(index);
 
@@ -385,6 +941,9 @@ Block* Cache::find_victim(u64 index) {
                 return block;
         }
 
+        if (!quotas.empty())
+            return partition_victim(index);
+
         // Time for a victim..
         victim_tag = lru_get(index);
 
@@ -398,7 +957,161 @@ Block* Cache::find_victim(u64 index) {
     return block;
 }
 
+void Cache::save_state(std::vector<u64>& out) const {
+    // Each set is saved in tag order (a fully associative cache is one set):
+    // way positions only matter to the first-empty search, which takes the
+    // first tag 0 way (kept in way order), and to a victim whose LRU tag is
+    // not resident, which takes the last way (saved after the set)
+    std::vector<const Block*> set;
+
+    for (size_t r = 0; r < cache.size(); r++) {
+        for (auto& block: cache[r])
+            set.push_back(&block);
+
+        if (ct == FULLY_ASSOC && r + 1 < cache.size())
+            continue;
+
+        const Block* last = set.back();
+
+        std::stable_sort(set.begin(), set.end(), [](const Block* a, const Block* b) { return a->tag < b->tag; });
+
+        for (auto block: set)
+            block->save_state(out);
+
+        if (set.size() > 1)
+            out.push_back(last->tag);
+
+        set.clear();
+    }
+
+    for (auto& l: lru)
+        l->save_state(out);
+
+    if (vc)
+        victim_cache->save_state(out);
+
+    out.push_back(last_addr);
+}
+
+void Cache::set_index_function(IndexFunction fn) {
+    if (fn != INDEX_BITS && ct == FULLY_ASSOC)
+        exit_on_error("A fully associative cache has no set index.");
+    if (fn == INDEX_SKEW && ct != SET_ASSOC)
+        exit_on_error("Skewed indexing needs at least two ways.");
+
+    indexing = fn;
+    index_bits = size.C - size.B - ((ct == SET_ASSOC) ? size.S : 0);
+    index_sets = (ct == FULLY_ASSOC) ? 1 : rows;
+
+    if (fn == INDEX_PRIME)
+        index_sets = (rows > 2) ? largest_prime(rows) : rows;
+
+    // The index no longer pins down any address bits: tag is the block address
+    if (fn != INDEX_BITS)
+        tag_mask = ~offset_mask;
+
+    set_fills.assign(rows, 0);
+}
+
+void Cache::count_sets() {
+    set_counts.assign(sets(), SetCounters());
+}
+
+u64 Cache::hashed_index(u64 block, int way) {
+    switch (indexing) {
+        case INDEX_XOR:
+            return xor_fold(block, index_bits);
+        case INDEX_PRIME:
+            return block % index_sets;
+        case INDEX_SKEW:
+            return skew_hash(block, way, index_bits);
+        default:
+            return block & (rows - 1);
+    }
+}
+
+void Cache::set_programs(const std::vector<cache_stats_t*>& per_program) {
+    program_stats = per_program;
+
+    for (auto cs: program_stats) {
+        cs->hit_time = stats->hit_time;
+        cs->miss_penalty = stats->miss_penalty;
+    }
+
+    set_program(0);
+}
+
+void Cache::set_quotas(const std::vector<int>& ways) {
+    if (!ways.empty() && (ct == DIRECT_MAPPED || indexing == INDEX_SKEW))
+        exit_on_error("Way partitioning needs an associative, unskewed cache.");
+    if (!ways.empty() && ways.size() != program_stats.size())
+        exit_on_error("Need one way quota per program.");
+
+    quotas = ways;
+}
+
+Block* Cache::partition_victim(u64 index) {
+    // Blocks of the set (the whole cache if fully associative)
+    set_blocks.clear();
+
+    if (ct == FULLY_ASSOC) {
+        for (auto& row: cache)
+            set_blocks.push_back(&row[0]);
+    } else {
+        for (auto& b: cache[index])
+            set_blocks.push_back(&b);
+    }
+
+    owned.assign(quotas.size(), 0);
+
+    for (auto b: set_blocks)
+        owned[b->owner]++;
+
+    // Under its quota: take the LRU block of a program over its own.
+    // At or over it: replace its own LRU block.
+    bool at_quota = owned[program] >= quotas[program];
+    auto& l = lru[(ct == FULLY_ASSOC) ? 0 : index];
+    Block* victim = nullptr;
+
+    l->order(lru_order);
+
+    for (u64 t: lru_order) {
+        Block* b = nullptr;
+
+        for (auto each: set_blocks) {
+            if (each->tag == t) {
+                b = each;
+                break;
+            }
+        }
+
+        if (b == nullptr)
+            continue;
+
+        if (victim == nullptr)
+            victim = b; // Plain LRU if nobody qualifies
+
+        if (at_quota ? b->owner == program : owned[b->owner] > quotas[b->owner]) {
+            victim = b;
+            break;
+        }
+    }
+
+    l->replace_victim(victim->tag);
+
+    return victim;
+}
+
 void Cache::lru_push(u64 tag, u64 index) {
+    if (indexing == INDEX_SKEW) {
+        // No per-set stacks: candidates come from different sets
+        Block* block = find_block(tag, index);
+
+        if (block != nullptr)
+            block->last_use = ++use_clock;
+        return;
+    }
+
     if (ct == DIRECT_MAPPED)
         return;
     else if (ct == FULLY_ASSOC) {
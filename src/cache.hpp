@@ -7,8 +7,13 @@
 
 #include "block.hpp"
 #include "cachesim.hpp"
+#include "indexing.hpp"
 #include "lru.hpp"
+#include "memory.hpp"
+#include "prefetch.hpp"
+#include "replacement.hpp"
 #include "victim.hpp"
+#include "writebuf.hpp"
 
 #define DEBUG false
 
@@ -25,6 +30,20 @@ enum CacheType {
 
 CacheType find_cache_type(CacheSize size);
 
+// Per-set counters (see Cache::count_sets())
+struct SetCounters {
+    u64 accesses, misses, evictions, vc_hits, write_backs;
+};
+
+// Width of addresses in the traces
+static const u64 ADDR_BITS = 64;
+
+// Hit time in cycles (grows with associativity)
+double cache_hit_time(CacheSize size);
+
+// Storage in bits: data plus tag, valid and dirty bits of the cache and VC
+u64 cache_storage_bits(CacheSize size);
+
 enum CacheResult {
     READ_HIT,
     READ_MISS,
@@ -42,11 +61,93 @@ public:
     Cache(CacheSize size, CacheType ct, cache_stats_t* cs);
     ~Cache();
 
-    CacheResult read(u64 addr);
-    CacheResult write(u64 addr);
+    inline CacheResult read(u64 addr) {
+        return read(addr, get_tag(addr), get_index(addr), get_offset(addr));
+    }
+
+    inline CacheResult write(u64 addr) {
+        return write(addr, get_tag(addr), get_index(addr), get_offset(addr));
+    }
+
+    // Dispatch a decoded trace record
+    inline CacheResult access(const Access& a) {
+        if (a.mode == REPEAT)
+            return repeat(repeat_reads(a), repeat_writes(a));
+
+        cur_pc = a.pc;
+
+        // Records spanning blocks are split
+        if (a.size > 1 && get_offset(a.addr) + a.size > offset_mask + 1)
+            return access_span(a);
+
+        last_addr = a.addr;
+        cur_end = get_offset(a.addr) + (a.size > 1 ? a.size - 1 : 0);
+        return (a.mode == WRITE) ? write(a.addr) : read(a.addr);
+    }
+
+    // Dispatch `n` records, splitting all addresses up front. `addrs`, if
+    // given, holds the records' addresses contiguously (see MultiSim)
+    void access_batch(const Access* batch, size_t n, const u64* addrs = nullptr);
+
+    // Replay guaranteed hits to the last accessed block (reduced traces)
+    CacheResult repeat(u64 reads, u64 writes);
 
     void compute_stats();
 
+    // Misses so far that miss_rate is computed from (never decreases)
+    u64 effective_misses();
+
+    // Attach a prefetcher (not owned); nullptr disables prefetching
+    void set_prefetcher(Prefetcher* pf);
+
+    // Select the write policy and write buffer
+    void set_write_config(const WriteConfig& wc);
+
+    // Attach a memory model (not owned); nullptr = fixed miss penalty
+    void set_memory(MemoryBackend* mem);
+
+    // Attach a PC-based reuse predictor (not owned); nullptr = plain LRU
+    void set_replacement(ReplacementPredictor* rp);
+
+    // Select the set index function (before the first access); also
+    // counts fills per set for the set usage statistics
+    void set_index_function(IndexFunction fn);
+
+    // Append everything that decides how future accesses behave (blocks,
+    // LRU stacks, victim cache, target of REPEAT records). Two caches with
+    // equal state produce the same results from then on. Prefetcher,
+    // timing, predictor and set statistics state are not included.
+    void save_state(std::vector<u64>& out) const;
+
+    // Count accesses, misses, evictions, VC hits and writebacks per set
+    // from now on. Everything is counted in the home set of the block
+    // concerned (FA: the one set; skewed: its way-0 set).
+    void count_sets();
+    const std::vector<SetCounters>& set_counters() const { return set_counts; }
+
+    // Called with the address and dirty bit of every valid block evicted
+    // from the cache (into the victim cache, if any); nullptr = none
+    typedef void (*EvictHook)(void* user, u64 block_addr, bool dirty);
+    void set_evict_hook(EvictHook hook, void* user) { evict_hook = hook; evict_user = user; }
+
+    // Blocks a program can hold in one set (1 = direct-mapped)
+    int ways() const { return (ct == SET_ASSOC) ? cols : (ct == FULLY_ASSOC ? rows : 1); }
+    u64 sets() const { return (ct == FULLY_ASSOC) ? 1 : rows; }
+    u64 block_bits() const { return size.B; }
+
+    // Count into `cs` from now on (compute_stats() works on it too)
+    void set_stats(cache_stats_t* cs) { stats = cs; }
+
+    // Shared-cache mode: one stats struct per program; blocks are tagged
+    // with the program that filled them
+    void set_programs(const std::vector<cache_stats_t*>& per_program);
+
+    // Following accesses belong to program `p`
+    void set_program(int p) { program = p; stats = program_stats[p]; }
+
+    // Ways of each set each program may fill into (empty = shared LRU)
+    void set_quotas(const std::vector<int>& ways);
+
 private:
     u64 tag_mask = 0, index_mask = 0, offset_mask = 0;
     CacheSize size;
@@ -56,13 +157,37 @@ private:
     std::vector<std::vector<Block>> cache;
     int rows, cols;
 
+    // Address of the last access() (target of REPEAT records)
+    u64 last_addr = 0;
+
+    // Accesses with the address already split into tag/index/offset
+    CacheResult read(u64 addr, u64 tag, u64 index, u64 offset);
+    CacheResult write(u64 addr, u64 tag, u64 index, u64 offset);
+
+    // Split addresses of the current access_batch()
+    std::vector<u64> batch_addrs, batch_tags, batch_indices, batch_offsets;
+
+    // One access per block touched by a record
+    CacheResult access_span(const Access& a);
+
     // Check cache for specific block
     Block* find_block(const u64 tag, const u64 index);
 
     cache_stats_t* stats;
 
-    Block* find_victim(u64 index);
+    Block* find_victim(u64 tag, u64 index);
     Block* evict(u64 tag, u64 index);
+    EvictHook evict_hook = nullptr;
+    void* evict_user = nullptr;
+
+    // Shared cache / way partitioning
+    int program = 0;
+    std::vector<cache_stats_t*> program_stats;
+    std::vector<int> quotas;
+    std::vector<u64> lru_order;    // Scratch for partition_victim()
+    std::vector<Block*> set_blocks;
+    std::vector<int> owned;
+    Block* partition_victim(u64 index);
 
     // LRU stack
     std::vector<std::shared_ptr<LRU>> lru;
@@ -74,13 +199,78 @@ private:
     VictimCache* victim_cache;
     Block* check_vc(const u64 addr);
 
+    // Prefetcher
+    Prefetcher* prefetcher = nullptr;
+    std::vector<u64> prefetch_queue;
+    void prefetch(u64 addr);
+    void run_prefetcher(u64 addr, bool trigger);
+    Block* check_stream(const u64 addr);
+
+    // Write policy / write buffer
+    WritePolicy write_policy = WRITE_BACK;
+    WriteBuffer* wbuf = nullptr;
+    double cycle = 0;          // Cache-local time (write buffer / memory model)
+    double fetch_stall = 0;    // Cycles the current access blocks on memory
+    Block* spill = nullptr;    // Block pushed out of the VC
+    void write_back(Block* block);
+    void write_through(u64 addr);
+    CacheResult write_around(u64 addr);
+    void tick();
+
+    // Set index function (see indexing.hpp)
+    IndexFunction indexing = INDEX_BITS;
+    u64 index_bits = 0;
+    u64 index_sets = 0;        // Sets the function can produce
+    u64 use_clock = 0;         // Skewed caches replace the least recently used candidate
+    std::vector<u64> set_fills; // Fills per set (empty = not counted)
+    u64 victim_set = 0;        // Set find_victim() picked from
+
+    // Per-set counters (empty = off) and the current access's set
+    std::vector<SetCounters> set_counts;
+    SetCounters* cur_set = nullptr;
+
+    inline void count_access(u64 index) {
+        if (!set_counts.empty()) {
+            cur_set = &set_counts[(ct == FULLY_ASSOC) ? 0 : index];
+            cur_set->accesses++;
+        }
+    }
+
+    // Counters of the set holding `block_addr`
+    inline SetCounters& home_set(u64 block_addr) {
+        return set_counts[(ct == FULLY_ASSOC) ? 0 : get_index(block_addr)];
+    }
+
+    u64 hashed_index(u64 block, int way);
+
+    // Block address a cached block holds
+    inline u64 block_address(const Block* block) {
+        return (indexing == INDEX_BITS) ? block->tag | (block->index << size.B) : block->tag;
+    }
+
+    // PC-aware replacement
+    ReplacementPredictor* replacement = nullptr;
+    uint32_t cur_pc = 0;       // PC of the current record (0 = unknown)
+    u64 cur_end = 0;           // Offset of the current record's last byte in its block
+    void predict_fill(Block* block, u64 tag, u64 index);
+    void predict_hit(Block* block, u64 tag, u64 index);
+    void demote(Block* block, u64 tag, u64 index);
+
+    // Memory model
+    MemoryBackend* memory = nullptr;
+    bool timed = false;        // Track `cycle` at all?
+    void fetch(u64 addr);
+
     // Cache index extraction
     inline u64 get_tag(u64 addr) {
         return addr & tag_mask;
     }
 
     inline u64 get_index(u64 addr) {
-        return (addr & index_mask) >> size.B;
+        if (indexing == INDEX_BITS)
+            return (addr & index_mask) >> size.B;
+
+        return hashed_index(addr >> size.B, 0);
     }
 
     inline u64 get_offset(u64 addr) {
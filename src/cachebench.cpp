@@ -0,0 +1,311 @@
+// C++ includes
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "cache.hpp"
+#include "chunktrace.hpp"
+#include "multisim.hpp"
+#include "trace.hpp"
+#include "util.hpp" // exit_on_error
+#include "workload.hpp"
+
+// C includes
+#include <unistd.h>
+
+/**
+    Throughput benchmarks for the simulator hot paths.
+
+    Every benchmark runs the same seeded access stream `repeats` times and
+    reports the median, so results are comparable across builds.
+*/
+
+struct BenchArgs {
+    u64 accesses;
+    int repeats;
+};
+
+// Geometries exercised by the Cache::read/write benchmarks
+struct BenchConfig {
+    const char* name;
+    CacheSize size;
+};
+
+static const BenchConfig CONFIGS[] = {
+    // C, B, S, K, V
+    { "DM",          { 15, 5, 0, 3, 0 } },
+    { "DM+VC",       { 15, 5, 0, 3, 4 } },
+    { "8-way",       { 15, 5, 3, 3, 0 } },
+    { "8-way+VC",    { 15, 5, 3, 3, 4 } },
+    { "8-way K=2",   { 15, 5, 3, 2, 0 } },
+    { "8-way K=4",   { 15, 5, 3, 4, 0 } },
+    { "FA",          { 12, 5, 7, 3, 0 } },
+    { "FA+VC",       { 12, 5, 7, 3, 4 } },
+};
+
+static const int NUM_CONFIGS = sizeof(CONFIGS) / sizeof(CONFIGS[0]);
+
+// Seeded workloads so every run sees the same stream
+static const char* STREAM_SPEC = "zipf:footprint=256K,gran=8,alpha=0.9,writes=0.25,seed=42";
+
+static const char* GENERATORS[] = {
+    "seq:footprint=16M,seed=42",
+    "stride:footprint=16M,stride=4K,seed=42",
+    "uniform:footprint=16M,seed=42",
+    "zipf:footprint=16M,alpha=0.99,seed=42",
+    "chase:footprint=16M,seed=42",
+};
+
+static const int NUM_GENERATORS = sizeof(GENERATORS) / sizeof(GENERATORS[0]);
+
+static void make_stream(u64 n, std::vector<Access>& out) {
+    WorkloadParams p = parse_workload(STREAM_SPEC);
+    p.count = n;
+
+    Workload* w = make_workload(p);
+    out.resize(n);
+    w->next_batch(out.data(), n);
+    delete w;
+}
+
+static std::string to_text(const std::vector<Access>& stream) {
+    std::ostringstream oss;
+
+    for (auto& a: stream)
+        oss << a.mode << " " << std::hex << a.addr << "\n";
+
+    return oss.str();
+}
+
+static double now_seconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+static double median(std::vector<double> v) {
+    std::sort(v.begin(), v.end());
+    return v[v.size() / 2];
+}
+
+static void report(const char* group, const char* name, u64 n, double seconds) {
+    double ns = seconds * 1e9 / n;
+    double rate = n / seconds / 1e6;
+
+    printf("%-10s %-14s %12" PRIu64 " %10.2f %12.2f\n", group, name, n, ns, rate);
+}
+
+static void bench_cache(const BenchArgs& args, const std::vector<Access>& stream) {
+    for (int c = 0; c < NUM_CONFIGS; c++) {
+        std::vector<double> times;
+
+        for (int r = 0; r < args.repeats; r++) {
+            cache_stats_t stats = {};
+            CacheSize size = CONFIGS[c].size;
+            Cache L1 (size, find_cache_type(size), &stats);
+
+            double start = now_seconds();
+
+            for (auto& a: stream)
+                L1.access(a);
+
+            times.push_back(now_seconds() - start);
+        }
+
+        report("access", CONFIGS[c].name, stream.size(), median(times));
+    }
+}
+
+static void bench_parse(const BenchArgs& args, const std::string& text, u64 n) {
+    std::vector<double> times;
+
+    for (int r = 0; r < args.repeats; r++) {
+        std::istringstream iss(text);
+        TraceReader trace(&iss);
+        Access a;
+        u64 count = 0;
+
+        double start = now_seconds();
+
+        while (trace.next(a))
+            count++;
+
+        times.push_back(now_seconds() - start);
+
+        if (count != n)
+            exit_on_error("Parse benchmark decoded the wrong number of records.");
+    }
+
+    report("parse", "text", n, median(times));
+}
+
+static void bench_chunked(const BenchArgs& args, const std::vector<Access>& stream) {
+    // Scratch file in the working directory
+    const std::string path = "cachebench.ctr.tmp";
+
+    {
+        ChunkedTraceWriter writer(path);
+
+        for (auto& a: stream)
+            writer.push(a);
+    }
+
+    ChunkedTrace trace(path);
+    std::vector<double> times;
+
+    for (int r = 0; r < args.repeats; r++) {
+        std::vector<Access> out;
+
+        double start = now_seconds();
+        trace.read(0, trace.records(), out);
+        times.push_back(now_seconds() - start);
+
+        if (out.size() != stream.size())
+            exit_on_error("Chunked benchmark decoded the wrong number of records.");
+    }
+
+    remove(path.c_str());
+
+    report("parse", "chunked", stream.size(), median(times));
+}
+
+static void bench_generators(const BenchArgs& args) {
+    std::vector<Access> batch(ACCESS_BATCH);
+
+    for (int g = 0; g < NUM_GENERATORS; g++) {
+        WorkloadParams p = parse_workload(GENERATORS[g]);
+        p.count = args.accesses;
+
+        Workload* w = make_workload(p);
+        std::vector<double> times;
+
+        for (int r = 0; r < args.repeats; r++) {
+            w->reset();
+
+            double start = now_seconds();
+
+            while (w->next_batch(batch.data(), batch.size()) > 0)
+                ;
+
+            times.push_back(now_seconds() - start);
+        }
+
+        std::string name = std::string(GENERATORS[g]);
+        report("gen", name.substr(0, name.find(':')).c_str(), args.accesses, median(times));
+
+        delete w;
+    }
+}
+
+static void bench_end_to_end(const BenchArgs& args, const std::string& text, u64 n) {
+    const int configs[] = { 0, 3, 6 }; // DM, 8-way+VC, FA
+
+    for (int c: configs) {
+        std::vector<double> times;
+
+        for (int r = 0; r < args.repeats; r++) {
+            std::istringstream iss(text);
+            TraceReader trace(&iss);
+            Access a;
+
+            cache_stats_t stats = {};
+            CacheSize size = CONFIGS[c].size;
+
+            double start = now_seconds();
+
+            Cache L1 (size, find_cache_type(size), &stats);
+
+            while (trace.next(a))
+                L1.access(a);
+
+            L1.compute_stats();
+
+            times.push_back(now_seconds() - start);
+        }
+
+        report("e2e", CONFIGS[c].name, n, median(times));
+    }
+}
+
+// Every config over one trace: N separate parse + simulate runs vs one
+// lockstep run. Rates are per trace access, for all configs together.
+static void bench_multi(const BenchArgs& args, const std::string& text, u64 n) {
+    std::vector<CacheSize> sizes;
+
+    for (int c = 0; c < NUM_CONFIGS; c++)
+        sizes.push_back(CONFIGS[c].size);
+
+    std::vector<double> separate, lockstep;
+
+    for (int r = 0; r < args.repeats; r++) {
+        double start = now_seconds();
+
+        for (auto& size: sizes) {
+            std::istringstream iss(text);
+            TraceReader trace(&iss);
+            Access a;
+
+            cache_stats_t stats = {};
+            Cache L1 (size, find_cache_type(size), &stats);
+
+            while (trace.next(a))
+                L1.access(a);
+
+            L1.compute_stats();
+        }
+
+        separate.push_back(now_seconds() - start);
+
+        start = now_seconds();
+
+        std::istringstream iss(text);
+        TraceReader trace(&iss);
+        MultiSim sim(sizes);
+
+        sim.run(&trace);
+        sim.compute_stats();
+
+        lockstep.push_back(now_seconds() - start);
+    }
+
+    report("multi", "separate", n, median(separate));
+    report("multi", "lockstep", n, median(lockstep));
+}
+
+int main(int argc, char **argv) {
+    BenchArgs args = { 1000000, 5 };
+    int c;
+
+    while ((c = getopt(argc, argv, "n:r:")) != -1) {
+        switch (c) {
+            case 'n':
+                args.accesses = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                args.repeats = static_cast<int>(strtol(optarg, NULL, 10));
+                break;
+            default:
+                exit_on_error("Usage: cachebench [-n accesses] [-r repeats]");
+        }
+    }
+
+    if (args.accesses == 0 || args.repeats <= 0)
+        exit_on_error("Accesses and repeats must be positive.");
+
+    std::vector<Access> stream;
+    make_stream(args.accesses, stream);
+    std::string text = to_text(stream);
+
+    printf("%-10s %-14s %12s %10s %12s\n", "group", "benchmark", "accesses", "ns/access", "Maccesses/s");
+
+    bench_cache(args, stream);
+    bench_parse(args, text, args.accesses);
+    bench_chunked(args, stream);
+    bench_generators(args);
+    bench_end_to_end(args, text, args.accesses);
+    bench_multi(args, text, args.accesses);
+
+    return 0;
+}
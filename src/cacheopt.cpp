@@ -1,10 +1,79 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <map>
 #include <string>
 
 #include "cache.hpp"
+#include "chunktrace.hpp"
+#include "multisim.hpp"
+#include "results.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 #include "util.hpp"
 
+// C includes
+#include <unistd.h>
+
+/**
+    Searches (B, S, K, V) for the lowest AAT under a storage budget.
+
+    For each geometry the largest C that fits the budget is used. Candidates
+    are ordered by their AAT on a short prefix of the trace, then simulated
+    in full while the best AAT so far (the incumbent) is known. Misses never
+    decrease, so hit_time + misses_so_far / accesses * miss_penalty is a
+    lower bound on a candidate's final AAT; once it exceeds the incumbent the
+    candidate is abandoned.
+
+    Each block size replays its own reduced copy of the trace (see
+    TraceReducer), which gives the same statistics with fewer records.
+*/
+
+// Search space
+struct SearchArgs {
+    u64 budget;           // Bytes, including tag/valid/dirty overhead
+    u64 B_min, B_max;
+    u64 K_min;            // Subblock sizes from 2^K_min up to the block size
+    u64 V_max;
+    bool exhaustive;      // Disable pruning (for checking the search)
+    int jobs;             // Candidates simulated together (and threads)
+    std::string results;  // Result store directory (empty = off)
+    StatsFormat format;
+};
+
+struct Candidate {
+    CacheSize size;
+    double hit_time;
+    double estimate;      // AAT on the trace prefix
+    bool stored;          // Full result came from the result store
+    cache_stats_t result;
+    double bound;         // Stored lower bound from an abandoned run (0 = none)
+};
+
+// Bookkeeping for one trace
+struct SearchStats {
+    u64 candidates = 0;
+    u64 pruned = 0;       // Hit time alone exceeds the incumbent
+    u64 aborted = 0;      // Lower bound crossed the incumbent mid-trace
+    u64 completed = 0;
+    u64 stored = 0;       // Completed from the result store
+    u64 accesses = 0;     // Records simulated, prefix estimates included
+    u64 estimated = 0;    // Of which in prefix estimates
+    u64 sweep = 0;        // Records an exhaustive search would simulate
+};
+
+// Accesses between lower-bound checks
+static const size_t CHECK_INTERVAL = 4096;
+
+// Prefix estimates of one block size cost at most 1/PREFIX_SHARE of one
+// candidate's full run, split over its candidates
+static const size_t PREFIX_SHARE = 4;
+
+// Shorter prefixes are mostly cold misses and order nothing
+static const size_t MIN_PREFIX = 4 * CHECK_INTERVAL;
+
+static const double NO_BOUND = 1e300;
+
 void print_data(double aat, CacheSize size) {
     std::cout << "C = " << size.C << ",";
     std::cout << "B = " << size.B << ",";
@@ -14,19 +83,246 @@ void print_data(double aat, CacheSize size) {
     std::cout << "AAT = " << aat << std::endl;
 }
 
-int main() {
-    u64 B, C, S, V, K;
+/**
+    Every (B, S, K, V) with the largest C that fits in the budget.
+*/
+void enumerate(const SearchArgs& args, std::vector<Candidate>& out) {
+    u64 budget_bits = args.budget * 8;
 
-    // C, B, S, K, V
-    CacheSize size;
-    CacheType ct;
-    cache_stats_t stats;
+    for (u64 B = args.B_min; B <= args.B_max; B++) {
+        for (u64 K = args.K_min; K < B; K++) {
+            for (u64 V = 0; V <= args.V_max; V++) {
+                for (u64 S = 0; ; S++) {
+                    // Smallest legal C for this S, then grow while it fits
+                    u64 C = B + S;
+                    CacheSize size = {C, B, S, K, V};
+
+                    if (cache_storage_bits(size) > budget_bits)
+                        break;
+
+                    while (true) {
+                        CacheSize bigger = {size.C + 1, B, S, K, V};
+                        if (cache_storage_bits(bigger) > budget_bits)
+                            break;
+                        size = bigger;
+                    }
+
+                    out.push_back({size, cache_hit_time(size), 0, false, {}, 0});
+                }
+            }
+        }
+    }
+}
+
+/**
+    Simulate the first `n` records of `trace` on every config in `sizes`, in
+    lockstep over `threads` threads. A config is dropped as soon as its AAT
+    lower bound exceeds `bound`; `total` is the number of accesses the bound
+    is computed against. `done[i]` is false for dropped configs, and
+    `lower[i]` their lower bound when dropped.
+*/
+void simulate(const std::vector<Access>& trace, size_t n, u64 total,
+              const std::vector<CacheSize>& sizes, double bound, int threads,
+              std::vector<cache_stats_t>& stats, std::vector<char>& done,
+              std::vector<double>& lower, u64& simulated) {
+    MultiSim sim(sizes);
+
+    lower.assign(sizes.size(), 0);
+
+    // Without a bound there is nothing to check along the way
+    size_t step = (bound < NO_BOUND) ? CHECK_INTERVAL : std::max<size_t>(n, 1);
+
+    for (size_t i = 0; i < n; i += step) {
+        size_t end = std::min(n, i + step);
+
+        sim.run(trace, i, end, threads);
+
+        for (size_t c = 0; c < sim.size(); c++) {
+            if (!sim.active(c))
+                continue;
+
+            simulated += end - i;
+
+            cache_stats_t& cs = sim.stats(c);
+            lower[c] = cs.hit_time +
+                static_cast<double>(sim.cache(c).effective_misses()) / total * cs.miss_penalty;
 
-    Cache* L1;
+            if (lower[c] > bound)
+                sim.deactivate(c);
+        }
+    }
+
+    sim.compute_stats();
+
+    stats.clear();
+    done.clear();
+
+    for (size_t c = 0; c < sim.size(); c++) {
+        stats.push_back(sim.stats(c));
+        done.push_back(sim.active(c));
+    }
+}
+
+void search(const SearchArgs& args, const std::vector<Access>& trace,
+            std::vector<Candidate> candidates, ResultStore* store,
+            const std::string& trace_key, CacheSize& best_size,
+            cache_stats_t& best_stats, SearchStats& ss) {
+    std::vector<cache_stats_t> stats;
+    std::vector<char> done;
+    std::vector<double> lower;
+
+    ss.candidates = candidates.size();
+
+    // Stored results are exact; they also make the best ordering estimate
+    if (store != nullptr) {
+        for (auto& c: candidates) {
+            c.stored = store->load(trace_key, config_key(c.size), c.result);
+
+            if (c.stored)
+                c.estimate = c.result.avg_access_time;
+            else
+                store->load_bound(trace_key, config_key(c.size), c.bound);
+        }
+    }
+
+    // Guaranteed hits collapsed once per block size, shared by every candidate
+    std::map<u64, std::vector<Access>> reduced;
+
+    for (auto& c: candidates) {
+        if (reduced.count(c.size.B) == 0)
+            reduce_trace(trace, c.size.B, reduced[c.size.B]);
+    }
+
+    double incumbent = NO_BOUND;
+
+    // Stored results seed the incumbent before anything is simulated
+    for (auto& c: candidates) {
+        if (c.stored && c.result.avg_access_time < incumbent) {
+            incumbent = c.result.avg_access_time;
+            best_size = c.size;
+            best_stats = c.result;
+        }
+    }
+
+    size_t to_run = 0;
+
+    for (auto& c: candidates) {
+        if (!c.stored) {
+            ss.sweep += reduced[c.size.B].size();
+            to_run++;
+        }
+    }
+
+    // With a single wave the order cannot matter
+    if (!args.exhaustive && to_run > static_cast<size_t>(args.jobs)) {
+        // Order by AAT on a prefix: good incumbents early make the bound bite
+        // Every candidate with the same B shares one lockstep run
+        for (auto& r: reduced) {
+            const std::vector<Access>& records = r.second;
+
+            std::vector<Candidate*> group;
+            std::vector<CacheSize> sizes;
+
+            for (auto& c: candidates) {
+                // Already known to lose: no need to estimate
+                if (c.stored || c.bound > incumbent)
+                    continue;
+
+                if (c.size.B == r.first) {
+                    group.push_back(&c);
+                    sizes.push_back(c.size);
+                }
+            }
 
-    std::ifstream ifs;
-    char mode;
-    u64 address;
+            if (group.empty())
+                continue;
+
+            size_t prefix = records.size() / (PREFIX_SHARE * group.size());
+
+            // Too short to pay off: these go after the estimated ones
+            if (prefix < MIN_PREFIX) {
+                for (Candidate* c: group)
+                    c->estimate = NO_BOUND;
+                continue;
+            }
+
+            u64 before = ss.accesses;
+            simulate(records, prefix, prefix, sizes, NO_BOUND, args.jobs, stats, done, lower, ss.accesses);
+            ss.estimated += ss.accesses - before;
+
+            for (size_t i = 0; i < group.size(); i++)
+                group[i]->estimate = stats[i].avg_access_time;
+        }
+
+        std::stable_sort(candidates.begin(), candidates.end(),
+            [](const Candidate& a, const Candidate& b) { return a.estimate < b.estimate; });
+    }
+
+    size_t next = 0;
+
+    // Waves of up to `jobs` candidates run in lockstep; the incumbent is
+    // updated between waves
+    while (next < candidates.size()) {
+        double bound = args.exhaustive ? NO_BOUND : incumbent;
+
+        std::vector<CacheSize> wave;
+        u64 B = ~static_cast<u64>(0);
+
+        for (; next < candidates.size() && wave.size() < static_cast<size_t>(args.jobs); next++) {
+            const Candidate& c = candidates[next];
+
+            if (c.stored) {
+                ss.completed++;
+                ss.stored++;
+                continue;
+            }
+
+            if (c.hit_time > bound || c.bound > bound) {
+                ss.pruned++;
+                continue;
+            }
+
+            wave.push_back(c.size);
+            B = std::min(B, c.size.B);
+        }
+
+        if (wave.empty())
+            continue;
+
+        // A trace reduced for the smallest block size is exact for all of them
+        const std::vector<Access>& records = reduced[B];
+
+        simulate(records, records.size(), trace.size(), wave, bound, args.jobs, stats, done, lower, ss.accesses);
+
+        for (size_t i = 0; i < wave.size(); i++) {
+            if (!done[i]) {
+                ss.aborted++;
+
+                if (store != nullptr)
+                    store->save_bound(trace_key, config_key(wave[i]), lower[i]);
+
+                continue;
+            }
+
+            ss.completed++;
+
+            if (store != nullptr)
+                store->save(trace_key, config_key(wave[i]), stats[i]);
+
+            if (stats[i].avg_access_time < incumbent) {
+                incumbent = stats[i].avg_access_time;
+                best_size = wave[i];
+                best_stats = stats[i];
+            }
+        }
+    }
+}
+
+void usage() {
+    exit_on_error("Usage: cacheopt [-b budget] [-B min-max] [-k K_min] [-v V_max] [-x] [-j jobs] [-r results] [-f format] [trace...]");
+}
+
+int main(int argc, char **argv) {
     std::vector<std::string> traces = {
         "traces/astar.trace",
         "traces/bzip2.trace",
@@ -34,56 +330,122 @@ int main() {
         "traces/perlbench.trace"
     };
 
-    // Select best params given 64 KB budget
-    C = 15;
-    V = 2;
-    B = 7;
-    K = 6;
+    // Default: 64 KB budget
+    SearchArgs args = { 64 * 1024, 4, 8, 2, 8, false, 1, "", FORMAT_TEXT };
+    int c;
 
-    for (int i = 0; i < traces.size(); i++) {
-        double aat_min = 999999;
-        CacheSize best_size;
+    while ((c = getopt(argc, argv, "b:B:k:v:xj:r:f:")) != -1) {
+        switch (c) {
+            case 'b':
+                args.budget = parse_size(optarg, 1024);
+                break;
+            case 'B': {
+                std::string range = optarg;
+                size_t dash = range.find('-');
 
-        for (S = 0; S <= (C - B); S++) {
-            ifs.open(traces[i]);
+                args.B_min = parse_size(range.substr(0, dash), 1);
+                args.B_max = dash == std::string::npos ? args.B_min : parse_size(range.substr(dash + 1), 1);
+                break;
+            }
+            case 'k':
+                args.K_min = parse_size(optarg, 1);
+                break;
+            case 'v':
+                args.V_max = parse_size(optarg, 1);
+                break;
+            case 'x':
+                args.exhaustive = true;
+                break;
+            case 'j':
+                args.jobs = static_cast<int>(parse_size(optarg, 1));
+                break;
+            case 'r':
+                args.results = optarg;
+                break;
+            case 'f':
+                args.format = parse_format(optarg);
+                break;
+            default:
+                usage();
+        }
+    }
 
-            size = {C, B, S, K, V};
-            ct = find_cache_type(size);
-            stats = {};
+    // Remaining args override the trace list
+    if (optind < argc)
+        traces.assign(argv + optind, argv + argc);
 
-            L1 = new Cache(size, ct, &stats);
+    if (args.jobs < 1)
+        exit_on_error("Need at least one job.");
 
-            // Core simulation loop
-            while (ifs >> mode >> std::hex >> address) {
-                switch (mode) {
-                    case 'r':
-                    case 'R':
-                        L1->read(address);
-                        break;
-                    case 'w':
-                    case 'W':
-                        L1->write(address);
-                        break;
-                    default:
-                        exit_on_error("Invalid input file format");
-                }
-            }
+    if (args.B_min > args.B_max || args.B_min <= args.K_min)
+        exit_on_error("Need K_min < B_min <= B_max.");
 
-            L1->compute_stats();
+    std::vector<Candidate> candidates;
+    enumerate(args, candidates);
 
-            // Determine if better than previous best
-            if (stats.avg_access_time < aat_min) {
-                aat_min = stats.avg_access_time;
-                best_size = size;
-            }
+    ResultStore* store = args.results.empty() ? nullptr : new ResultStore(args.results);
+
+    if (candidates.empty())
+        exit_on_error("No configuration fits the budget.");
 
-            delete L1;
-            ifs.close();
+    for (size_t i = 0; i < traces.size(); i++) {
+        // Decode once; every candidate replays the same accesses
+        std::vector<Access> trace;
+        u64 reduced_B;
+
+        if (is_chunked_trace(traces[i])) {
+            // Chunks decode in parallel
+            ChunkedTrace chunked(traces[i]);
+            chunked.read(0, chunked.records(), trace, args.jobs);
+            reduced_B = chunked.block_bits();
+        } else {
+            std::ifstream ifs(traces[i]);
+
+            if (!ifs.good())
+                exit_on_error("File not found: " + traces[i]);
+
+            TraceReader reader(&ifs);
+            reader.read_all(trace);
+            reduced_B = reader.block_bits();
         }
 
-        std::cout << "Trace: " << traces[i] << std::endl;
-        print_data(aat_min, best_size);
+        // Candidates get traces reduced for their own block size
+        if (reduced_B > 0)
+            exit_on_error("cacheopt needs an unreduced trace: " + traces[i]);
+
+        if (trace.empty())
+            exit_on_error("Empty trace: " + traces[i]);
+
+        CacheSize best_size;
+        cache_stats_t best_stats = {};
+        SearchStats ss;
+
+        std::string trace_key = store ? file_key(traces[i]) : "";
+
+        search(args, trace, candidates, store, trace_key, best_size, best_stats, ss);
+
+        if (args.format == FORMAT_TEXT) {
+            std::cout << "Trace: " << traces[i] << std::endl;
+            print_data(best_stats.avg_access_time, best_size);
+            std::cout << "Candidates: " << ss.candidates << ", pruned: " << ss.pruned
+                      << ", aborted: " << ss.aborted << ", completed: " << ss.completed
+                      << " (" << ss.stored << " stored)" << std::endl;
+            // Against simulating every candidate in full on its reduced trace
+            u64 full = ss.accesses - ss.estimated;
+
+            std::cout << "Simulated accesses: " << ss.accesses << " (" << ss.estimated
+                      << " in prefix estimates) of " << ss.sweep << " for an exhaustive search" << std::endl;
+
+            if (ss.sweep > 0)
+                std::cout << "Saved by the bound: " << 100.0 * (1 - static_cast<double>(full) / ss.sweep)
+                          << "%, net of estimates: " << 100.0 * (1 - static_cast<double>(ss.accesses) / ss.sweep)
+                          << "%" << std::endl;
+        } else {
+            print_results(stdout, &best_stats, best_size, args.format, traces[i], i == 0);
+        }
     }
 
+    delete store;
+
     return 0;
-}
\ No newline at end of file
+}
@@ -2,39 +2,62 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <thread>
 
 #include "cachesim.hpp"
 #include "cache.hpp"
+#include "chunktrace.hpp"
+#include "organization.hpp"
+#include "events.hpp"
+#include "partition.hpp"
+#include "prefetch.hpp"
+#include "profile.hpp"
+#include "results.hpp"
+#include "server.hpp"
+#include "setstats.hpp"
+#include "stats.hpp"
+#include "timeparallel.hpp"
+#include "tlb.hpp"
+#include "trace.hpp"
+#include "workload.hpp"
 #include "util.hpp" // exit_on_error
 
 // C includes
 #include <unistd.h>
 
-void print_statistics(cache_stats_t* p_stats) {
-    printf("\nCache Statistics\n");
-    printf("================\n");
-    printf("Accesses: %" PRIu64 "\n", p_stats->accesses);
-    printf("Reads: %" PRIu64 "\n", p_stats->reads);
-    printf("Read misses: %" PRIu64 "\n", p_stats->read_misses);
-    printf("Read misses combined: %" PRIu64 "\n", p_stats->read_misses_combined);
-    printf("Writes: %" PRIu64 "\n", p_stats->writes);
-    printf("Write misses: %" PRIu64 "\n", p_stats->write_misses);
-    printf("Write misses combined: %" PRIu64 "\n", p_stats->write_misses_combined);
-    printf("Misses: %" PRIu64 "\n", p_stats->misses);
-    printf("Writebacks: %" PRIu64 "\n", p_stats->write_backs);
-    printf("Victim cache misses: %" PRIu64 "\n", p_stats->vc_misses);
-    printf("Sub-block misses: %" PRIu64 "\n", p_stats->subblock_misses);
-    printf("Bytes transferred to/from memory: %" PRIu64 "\n", p_stats->bytes_transferred);
-    printf("Hit Time: %f\n", p_stats->hit_time);
-    printf("Miss Penalty: %f\n", p_stats->miss_penalty);
-    printf("Miss rate: %f\n", p_stats->miss_rate);
-    printf("Average access time (AAT): %f\n", p_stats->avg_access_time);
-}
-
 // Struct type for input argument storage
 struct inputargs_t {
     u64 C, B, S, V, K, N;
     std::istream *trace_file;
+    ChunkedTrace *chunked;  // Set instead of trace_file for chunked traces
+    std::string trace_name;
+    u64 skip, count;        // Window: skip records, then simulate `count` (0 = all)
+    u64 segments;           // Time-parallel segments (0 or 1 = serial)
+    std::string workload; // Synthetic workload spec (replaces the trace)
+    std::string prefetcher; // Prefetcher spec (empty = none)
+    WriteConfig write;      // Write policy and buffer
+    std::string write_spec; // As given (for result keys)
+    std::string memory;     // Memory model spec (empty = fixed penalty)
+    std::string index;      // Set index function (empty = bitfield, no set stats)
+    std::string replacement; // PC-aware replacement spec (empty = LRU)
+    std::string tlb;        // TLB and page size spec (empty = no translation)
+    std::string organization; // Sectored/compressed cache spec (empty = conventional)
+    std::string results;    // Result store directory (empty = off)
+    std::string events;     // Per-access event file (empty = off)
+    std::string server;     // Serve sessions on this Unix socket (empty = off)
+    bool profile;           // Report host cost per phase and per access
+    u64 set_top;            // Per-set report with the N hottest sets (0 = off)
+    std::string set_file;   // Per-set counters as CSV (empty = off)
+
+    // Shared cache (replaces the single trace)
+    std::vector<std::string> programs; // One trace per program
+    u64 quantum;                       // Accesses per turn
+    PartitionConfig partition;
+
+    // Output options
+    u64 interval;       // Emit deltas every `interval` accesses (0 = off)
+    StatsFormat format;
+    FILE *interval_file;
 };
 
 /**
@@ -46,11 +69,11 @@ void parse_args(int argc, char **argv, inputargs_t& args) {
     extern int optind;
 
     // Args string for getopt()
-    static const char* ALLOWED_ARGS = "C:B:S:V:K:i:";
+    static const char* ALLOWED_ARGS = "C:B:S:V:K:i:I:f:o:g:p:w:M:r:s:n:e:P:Q:W:H:R:T:u:xL:y:Y:O:";
     
     int c;
     u64 num = 0;  // Stores converted arg from char* to uint64_t
-    u64 *arg; // Pointer to struct arg (DRY)
+    u64 *arg = nullptr; // Pointer to struct arg (DRY)
 
     // Set defaults for args
     args.C = DEFAULT_C;
@@ -59,9 +82,31 @@ void parse_args(int argc, char **argv, inputargs_t& args) {
     args.V = DEFAULT_V;
     args.K = DEFAULT_K;
     args.trace_file = nullptr;
+    args.chunked = nullptr;
+    args.trace_name = "-";
+    args.skip = 0;
+    args.count = 0;
+    args.segments = 0;
+    args.workload = "";
+    args.prefetcher = "";
+    args.memory = "";
+    args.index = "";
+    args.replacement = "";
+    args.tlb = "";
+    args.organization = "";
+    args.results = "";
+    args.events = "";
+    args.server = "";
+    args.profile = false;
+    args.set_top = 0;
+    args.set_file = "";
+    args.quantum = 1;
+    args.interval = 0;
+    args.format = FORMAT_TEXT;
+    args.interval_file = stdout;
 
     while ((c = getopt(argc, argv, ALLOWED_ARGS)) != -1) {
-        if (c == 'C' || c == 'B' || c == 'S' || c == 'V' || c == 'K')
+        if (c == 'C' || c == 'B' || c == 'S' || c == 'V' || c == 'K' || c == 'I' || c == 's' || c == 'n' || c == 'Q' || c == 'T' || c == 'y')
             num = strtol(optarg, NULL, 10);
         
         switch (c) {
@@ -80,7 +125,104 @@ void parse_args(int argc, char **argv, inputargs_t& args) {
             case 'K':
                 arg = &(args.K);
                 break;
-            case 'i':
+            case 'I':
+                arg = &(args.interval);
+                break;
+            case 's':
+                arg = &(args.skip);
+                break;
+            case 'n':
+                arg = &(args.count);
+                break;
+            case 'Q':
+                arg = &(args.quantum);
+                break;
+            case 'T':
+                arg = &(args.segments);
+                break;
+            case 'y':
+                arg = &(args.set_top);
+                break;
+            case 'Y':
+                args.set_file = optarg;
+                break;
+            case 'P': {
+                // Comma-separated trace files
+                std::string list = optarg;
+                size_t pos = 0;
+
+                while (pos <= list.size()) {
+                    size_t comma = list.find(',', pos);
+                    if (comma == std::string::npos)
+                        comma = list.size();
+
+                    args.programs.push_back(list.substr(pos, comma - pos));
+                    pos = comma + 1;
+                }
+                break;
+            }
+            case 'W':
+                args.partition = parse_partition(optarg);
+                break;
+            case 'f':
+                args.format = parse_format(optarg);
+                break;
+            case 'o':
+                args.interval_file = fopen(optarg, "w");
+
+                if (args.interval_file == nullptr)
+                    exit_on_error("Could not open interval output file.");
+                break;
+            case 'p':
+                args.prefetcher = optarg;
+                break;
+            case 'w':
+                args.write = parse_write_config(optarg);
+                args.write_spec = optarg;
+                break;
+            case 'M':
+                args.memory = optarg;
+                break;
+            case 'R':
+                args.replacement = optarg;
+                break;
+            case 'H':
+                parse_index(optarg);
+                args.index = optarg;
+                break;
+            case 'L':
+                parse_tlb(optarg);
+                args.tlb = optarg;
+                break;
+            case 'O':
+                parse_organization(optarg);
+                args.organization = optarg;
+                break;
+            case 'r':
+                args.results = optarg;
+                break;
+            case 'e':
+                args.events = optarg;
+                break;
+            case 'u':
+                args.server = optarg;
+                break;
+            case 'x':
+                args.profile = true;
+                break;
+            case 'g':
+                args.workload = optarg;
+                args.trace_name = optarg;
+                break;
+            case 'i': {
+                args.trace_name = optarg;
+
+                // Chunked traces are read through their index
+                if (is_chunked_trace(optarg)) {
+                    args.chunked = new ChunkedTrace(optarg);
+                    break;
+                }
+
                 // Create a pointer for persistence
                 // Then open the file in read mode
                 std::ifstream *ifs = new std::ifstream();
@@ -90,9 +232,13 @@ void parse_args(int argc, char **argv, inputargs_t& args) {
                     exit_on_error("File not found.");
 
                 args.trace_file = ifs;
+                break;
+            }
+            default:
+                exit_on_error("Unknown argument.");
         }
         
-        if (c != 'i')
+        if (c != 'i' && c != 'f' && c != 'o' && c != 'g' && c != 'p' && c != 'w' && c != 'M' && c != 'r' && c != 'e' && c != 'P' && c != 'W' && c != 'H' && c != 'R' && c != 'u' && c != 'x' && c != 'L' && c != 'Y' && c != 'O')
             *arg = static_cast<uint64_t>(num);
     }
 
@@ -102,6 +248,415 @@ void parse_args(int argc, char **argv, inputargs_t& args) {
     // Error checking
     if (args.B > args.C)
         exit_on_error("B cannot be greater than C.");
+
+    // Only state that Cache::save_state() covers can be reconciled
+    if (args.segments > 1 && (!args.prefetcher.empty() || !args.memory.empty() ||
+            args.write.buffer > 0 || !args.replacement.empty() || !args.index.empty() ||
+            args.interval > 0 || !args.events.empty() || !args.programs.empty()))
+        exit_on_error("-T does not support -p, -M, write buffers, -R, -H, -I, -e or -P.");
+
+    // Clients bring the accesses
+    if (!args.server.empty() && (args.trace_file != nullptr || args.chunked != nullptr ||
+            !args.workload.empty() || !args.programs.empty() || args.segments > 1 ||
+            args.interval > 0 || !args.events.empty() || !args.results.empty() ||
+            args.skip > 0 || args.count > 0))
+        exit_on_error("-u does not take a trace, -g, -P, -T, -I, -e, -r, -s or -n.");
+
+    // Walk accesses share the cache but not the data stats
+    if (!args.tlb.empty() && (args.segments > 1 || !args.programs.empty() ||
+            !args.server.empty() || !args.events.empty()))
+        exit_on_error("-L does not support -T, -P, -u or -e.");
+
+    if ((args.set_top > 0 || !args.set_file.empty()) &&
+            (args.segments > 1 || !args.programs.empty() || !args.server.empty()))
+        exit_on_error("-y and -Y do not support -T, -P or -u.");
+
+    // Sectored and compressed caches are plain write-back LRU caches
+    if (!args.organization.empty() && (!args.prefetcher.empty() || !args.memory.empty() ||
+            args.write.policy != WRITE_BACK || args.write.buffer > 0 || !args.replacement.empty() ||
+            !args.index.empty() || args.segments > 1 || !args.programs.empty() || !args.server.empty() ||
+            !args.events.empty() || !args.tlb.empty() || args.set_top > 0 || !args.set_file.empty() ||
+            args.interval > 0))
+        exit_on_error("-O does not support -p, -M, -w, -R, -H, -T, -P, -u, -e, -L, -y, -Y or -I.");
+
+    if (args.profile && (!args.server.empty() || !args.programs.empty()))
+        exit_on_error("-x profiles single-cache runs only (not -u or -P).");
+
+    if (args.partition.policy != PART_NONE && args.programs.empty())
+        exit_on_error("Partitioning needs several programs (-P).");
+
+    if (!args.programs.empty()) {
+        if (args.programs.size() < 2)
+            exit_on_error("A shared cache needs at least two traces.");
+        if (args.trace_file != nullptr || args.chunked != nullptr || !args.workload.empty())
+            exit_on_error("Use either -P or a single trace.");
+
+        // Plain LRU caches only: no per-program timing or prefetch state
+        if (!args.prefetcher.empty() || !args.memory.empty() || args.write.policy != WRITE_BACK ||
+                args.write.buffer > 0 || args.interval > 0 || !args.events.empty() ||
+                !args.results.empty() || args.skip > 0 || args.count > 0 || !args.replacement.empty())
+            exit_on_error("-P does not support -p, -M, -w, -R, -I, -e, -r, -s or -n.");
+    }
+}
+
+/**
+    Core simulation loop (batched to amortize decoding). Simulates up to
+    `count` records (0 = all) and hands every access and its result to
+    `sink` (see events.hpp). With a `tlb`, every access is translated
+    first. With a `profiler`, decoding and simulating each batch are
+    attributed to their phases.
+*/
+template <class Sink>
+void run_loop(Cache& L1, AccessSource* source, cache_stats_t& stats, u64 count,
+              IntervalWriter* intervals, u64 interval, u64& next_interval, Sink& sink,
+              Tlb* tlb, Profiler* profiler) {
+    std::vector<Access> batch(ACCESS_BATCH);
+    u64 remaining = (count > 0) ? count : ~static_cast<u64>(0);
+    size_t n;
+
+    while (remaining > 0) {
+        if (profiler != nullptr)
+            profiler->enter(PHASE_PARSE);
+
+        if ((n = source->next_batch(batch.data(), std::min<u64>(batch.size(), remaining))) == 0)
+            break;
+
+        if (profiler != nullptr)
+            profiler->enter(PHASE_SIMULATE);
+
+        remaining -= n;
+
+        for (size_t i = 0; i < n; i++) {
+            // Repeats stay on the page of the access before them
+            if (tlb != nullptr && batch[i].mode != REPEAT)
+                tlb->translate(batch[i].addr);
+
+            CacheResult cr = L1.access(batch[i]);
+            sink.record(batch[i], cr, stats);
+
+            if (intervals != nullptr && stats.accesses >= next_interval) {
+                intervals->snapshot(stats);
+                next_interval += interval;
+            }
+        }
+    }
+}
+
+/**
+    Run the simulation described by `args` over `fs` (or the workload).
+*/
+void simulate(inputargs_t& args, std::istream* fs, CacheSize cache_size, cache_stats_t& stats,
+              Profiler* profiler, std::vector<SetCounters>& set_counters) {
+    // Find cache type (DM, FA, or SA)
+    // Exits if invalid parameters
+    CacheType ct = find_cache_type(cache_size);
+
+    // Create L1 cache with given size, type
+    // Pass in stats object
+    Cache L1 (cache_size, ct, &stats);
+
+    L1.set_write_config(args.write);
+
+    if (!args.index.empty())
+        L1.set_index_function(parse_index(args.index));
+
+    if (args.set_top > 0 || !args.set_file.empty())
+        L1.count_sets();
+
+    // Optional memory model (replaces the fixed miss penalty)
+    MemoryBackend* memory = nullptr;
+
+    if (!args.memory.empty()) {
+        memory = make_memory(args.memory, args.B);
+        L1.set_memory(memory);
+    }
+
+    // Optional PC-based reuse predictor
+    ReplacementPredictor* replacement = nullptr;
+
+    if (!args.replacement.empty()) {
+        replacement = make_replacement(args.replacement);
+        L1.set_replacement(replacement);
+    }
+
+    // Optional hardware prefetcher
+    Prefetcher* prefetcher = nullptr;
+
+    if (!args.prefetcher.empty()) {
+        prefetcher = make_prefetcher(args.prefetcher, args.B);
+        L1.set_prefetcher(prefetcher);
+    }
+
+    // Optional address translation in front of the cache
+    Tlb* tlb = nullptr;
+
+    if (!args.tlb.empty())
+        tlb = new Tlb(parse_tlb(args.tlb), &L1, &stats);
+
+    // Interval time series (written on a background thread)
+    IntervalWriter* intervals = nullptr;
+    u64 next_interval = args.interval;
+
+    if (args.interval > 0)
+        intervals = new IntervalWriter(args.interval_file, args.format, args.V > 0);
+
+    // Accesses come from the trace or from an in-memory generator
+    AccessSource* source;
+
+    u64 reduced_B = 0;
+    u64 skip = args.skip;
+
+    if (!args.workload.empty()) {
+        source = make_workload(parse_workload(args.workload));
+    } else if (args.chunked != nullptr) {
+        ChunkedTraceReader* reader = new ChunkedTraceReader(args.chunked);
+
+        // Straight to the window through the chunk index
+        reader->seek(skip);
+        skip = 0;
+
+        reduced_B = args.chunked->block_bits();
+        source = reader;
+    } else {
+        TraceReader* reader = new TraceReader(fs);
+
+        reduced_B = reader->block_bits();
+        source = reader;
+    }
+
+    // A reduced trace is only exact for blocks at least as large as its own
+    if (reduced_B > args.B)
+        exit_on_error("Trace was reduced for a larger block size.");
+    if (reduced_B > 0 && args.interval > 0)
+        exit_on_error("Interval mode needs an unreduced trace.");
+
+    // Repeat records refer back to earlier accesses
+    if (reduced_B > 0 && args.skip > 0)
+        exit_on_error("A reduced trace cannot be started part way through.");
+
+    // Other sources decode their way to the window
+    Access skipped;
+
+    for (u64 i = 0; i < skip && source->next(skipped); i++)
+        ;
+
+    if (!args.organization.empty()) {
+        OrgConfig org_config = parse_organization(args.organization);
+
+        // Sectors evicted one at a time leave gaps, so a hit says nothing
+        // about the rest of the block
+        if (reduced_B > 0 && org_config.kind == ORG_SECTORED)
+            exit_on_error("Decoupled sectored caches need an unreduced trace.");
+
+        OrganizedCache* org = make_organization(cache_size, org_config, &stats);
+        std::vector<Access> batch(ACCESS_BATCH);
+        u64 remaining = (args.count > 0) ? args.count : ~static_cast<u64>(0);
+        size_t n;
+
+        while (remaining > 0) {
+            if (profiler != nullptr)
+                profiler->enter(PHASE_PARSE);
+
+            if ((n = source->next_batch(batch.data(), std::min<u64>(batch.size(), remaining))) == 0)
+                break;
+
+            if (profiler != nullptr)
+                profiler->enter(PHASE_SIMULATE);
+
+            remaining -= n;
+
+            for (size_t i = 0; i < n; i++)
+                org->access(batch[i]);
+        }
+
+        org->compute_stats();
+
+        delete org;
+        delete source;
+        return;
+    }
+
+    if (args.segments > 1) {
+        // Whole window in memory, then split in time
+        std::vector<Access> trace;
+        std::vector<Access> batch(ACCESS_BATCH);
+        u64 remaining = (args.count > 0) ? args.count : ~static_cast<u64>(0);
+        size_t n;
+
+        while (remaining > 0 &&
+                (n = source->next_batch(batch.data(), std::min<u64>(batch.size(), remaining))) > 0) {
+            trace.insert(trace.end(), batch.begin(), batch.begin() + n);
+            remaining -= n;
+        }
+
+        int threads = std::min<int>(args.segments, std::max(1u, std::thread::hardware_concurrency()));
+        TimeParallelSim sim(cache_size, args.write, args.segments, threads);
+
+        if (profiler != nullptr)
+            profiler->enter(PHASE_SIMULATE);
+
+        sim.run(trace, stats);
+
+        fprintf(stderr, "Time-parallel: %" PRIu64 " segments, %" PRIu64 " records re-simulated, %d unconverged\n",
+                args.segments, sim.fixup_records(), sim.unconverged());
+
+        delete source;
+        delete prefetcher;
+        delete replacement;
+        delete memory;
+        return;
+    }
+
+    // The sink is a template policy: untraced runs get the plain loop
+    if (!args.events.empty()) {
+        EventWriter writer(args.events);
+        EventSink sink(&writer, L1, args.skip);
+
+        run_loop(L1, source, stats, args.count, intervals, args.interval, next_interval, sink, tlb, profiler);
+    } else {
+        NullSink sink;
+
+        run_loop(L1, source, stats, args.count, intervals, args.interval, next_interval, sink, tlb, profiler);
+    }
+
+    delete source;
+
+    if (intervals != nullptr) {
+        // Flush the partial last interval
+        if (stats.accesses + args.interval != next_interval)
+            intervals->snapshot(stats);
+
+        delete intervals;
+
+        if (args.interval_file != stdout)
+            fclose(args.interval_file);
+    }
+
+    L1.compute_stats();
+    set_counters = L1.set_counters();
+
+    if (tlb != nullptr) {
+        tlb->finish();
+        delete tlb;
+    }
+
+    delete prefetcher;
+    delete replacement;
+    delete memory;
+}
+
+/**
+    Decode a whole (unreduced) trace file, text or chunked, for shared-cache
+    mode: its addresses must leave the top byte free for the program number
+    (see program_addr()).
+*/
+void load_trace(const std::string& path, std::vector<Access>& out) {
+    if (is_chunked_trace(path)) {
+        ChunkedTrace trace(path);
+
+        if (trace.block_bits() > 0)
+            exit_on_error("Shared-cache mode needs unreduced traces: " + path);
+
+        trace.read(0, trace.records(), out);
+    } else {
+        std::ifstream ifs(path);
+
+        if (!ifs.good())
+            exit_on_error("File not found: " + path);
+
+        TraceReader reader(&ifs);
+
+        if (reader.block_bits() > 0)
+            exit_on_error("Shared-cache mode needs unreduced traces: " + path);
+
+        reader.read_all(out);
+    }
+
+    for (const Access& a: out) {
+        if ((a.addr + (a.size > 1 ? a.size - 1 : 0)) >> PROGRAM_SHIFT != 0)
+            exit_on_error("Shared-cache mode needs addresses below 2^56: " + path);
+    }
+}
+
+/**
+    Run the -P programs on one shared cache, then each alone on the same
+    geometry, and report per-program slowdowns.
+*/
+void simulate_shared(inputargs_t& args, CacheSize cache_size) {
+    int n = args.programs.size();
+    CacheType ct = find_cache_type(cache_size);
+
+    if (n > MAX_PROGRAMS)
+        exit_on_error("Shared-cache mode runs at most " + std::to_string(MAX_PROGRAMS) + " programs.");
+
+    std::vector<std::vector<Access>> traces(n);
+
+    for (int p = 0; p < n; p++)
+        load_trace(args.programs[p], traces[p]);
+
+    // Shared run
+    cache_stats_t total = {};
+    std::vector<cache_stats_t> shared(n, cache_stats_t());
+    Cache L1 (cache_size, ct, &total);
+
+    if (!args.index.empty())
+        L1.set_index_function(parse_index(args.index));
+
+    SharedSim sim(L1, args.partition, args.quantum);
+
+    sim.run(traces, shared);
+
+    for (auto& cs: shared)
+        add_stats(total, cs);
+
+    L1.set_stats(&total);
+    L1.compute_stats();
+
+    // Each program alone
+    std::vector<cache_stats_t> alone(n, cache_stats_t());
+
+    for (int p = 0; p < n; p++) {
+        Cache solo (cache_size, ct, &alone[p]);
+
+        if (!args.index.empty())
+            solo.set_index_function(parse_index(args.index));
+
+        for (auto& a: traces[p])
+            solo.access(a);
+
+        solo.compute_stats();
+    }
+
+    if (args.format != FORMAT_TEXT) {
+        print_results(stdout, &total, cache_size, args.format, "shared");
+
+        for (int p = 0; p < n; p++) {
+            print_results(stdout, &shared[p], cache_size, args.format, "shared:" + args.programs[p], false);
+            print_results(stdout, &alone[p], cache_size, args.format, "alone:" + args.programs[p], false);
+        }
+
+        return;
+    }
+
+    print_statistics(&total);
+
+    // Slowdown = shared AAT / alone AAT; weighted speedup sums the inverses
+    double weighted = 0;
+
+    printf("\nProgram                  Accesses  Ways  Shared MR  Alone MR  Shared AAT  Alone AAT  Slowdown  Evicted by others\n");
+
+    for (int p = 0; p < n; p++) {
+        double slowdown = shared[p].avg_access_time / alone[p].avg_access_time;
+        weighted += 1 / slowdown;
+
+        printf("%-24s %9" PRIu64 " %5d %10.6f %9.6f %11.3f %10.3f %9.3f %18" PRIu64 "\n",
+               args.programs[p].c_str(), shared[p].accesses, sim.ways()[p],
+               shared[p].miss_rate, alone[p].miss_rate,
+               shared[p].avg_access_time, alone[p].avg_access_time,
+               slowdown, shared[p].evicted_by_others);
+    }
+
+    printf("Weighted speedup: %.3f\n", weighted);
 }
 
 int main(int argc, char **argv) {
@@ -134,41 +689,87 @@ int main(int argc, char **argv) {
         args.V
     };
 
-    // Find cache type (DM, FA, or SA)
-    // Exits if invalid parameters
-    CacheType ct = find_cache_type(cache_size);
+    if (!args.programs.empty()) {
+        simulate_shared(args, cache_size);
+        return 0;
+    }
 
-    // Create L1 cache with given size, type
-    // Pass in stats object
-    Cache L1 (cache_size, ct, &stats);
+    if (!args.server.empty()) {
+        ServerConfig config = {cache_size, args.write, args.prefetcher, args.memory,
+                               args.replacement, args.index};
+        SimServer server(args.server, config);
 
-    // Variables for formatting trace input
-    char mode;
-    u64 address;
+        server.run();
+        return 0;
+    }
 
-    // Core simulation loop
-    while (*fs >> mode >> std::hex >> address) {
-        switch (mode) {
-            case 'r':
-            case 'R':
-                L1.read(address);
-                break;
-            case 'w':
-            case 'W':
-                L1.write(address);
-                break;
-            default:
-                exit_on_error("Invalid input file format");
-        }
+    // Host profile of the run (phases start with decoding)
+    Profiler* profiler = nullptr;
+
+    if (args.profile) {
+        profiler = new Profiler();
+        profiler->enter(PHASE_PARSE);
     }
 
-    L1.compute_stats();
+    // Finished results can come from the store
+    ResultStore* store = nullptr;
+    std::string trace_key, config;
+
+    std::vector<SetCounters> set_counters;
+
+    if (!args.results.empty() && args.interval == 0 && args.events.empty() && !args.profile &&
+            args.set_top == 0 && args.set_file.empty() &&
+            (file || args.chunked != nullptr || !args.workload.empty())) {
+        store = new ResultStore(args.results);
+        trace_key = args.workload.empty() ? file_key(args.trace_name) : "gen:" + args.workload;
+        config = config_key(cache_size, args.write_spec, args.prefetcher, args.memory);
+
+        if (args.skip > 0 || args.count > 0)
+            config += ";window=" + std::to_string(args.skip) + "+" + std::to_string(args.count);
 
-    print_statistics(&stats);
+        if (!args.index.empty())
+            config += ";index=" + args.index;
+        if (!args.replacement.empty())
+            config += ";R=" + args.replacement;
+        if (!args.tlb.empty())
+            config += ";L=" + args.tlb;
+        if (!args.organization.empty())
+            config += ";O=" + args.organization;
+    }
+
+    if (store == nullptr || !store->load(trace_key, config, stats)) {
+        simulate(args, fs, cache_size, stats, profiler, set_counters);
+
+        if (store != nullptr)
+            store->save(trace_key, config, stats);
+    }
+
+    delete store;
+
+    if (profiler != nullptr)
+        profiler->enter(PHASE_REPORT);
+
+    print_results(stdout, &stats, cache_size, args.format, args.trace_name);
+
+    if (args.set_top > 0)
+        print_set_report(args.format == FORMAT_TEXT ? stdout : stderr, set_counters, args.set_top);
+
+    if (!args.set_file.empty())
+        write_set_counters(args.set_file, set_counters);
+
+    if (profiler != nullptr) {
+        profiler->stop();
+
+        // Keep machine-readable output clean
+        profiler->print(args.format == FORMAT_TEXT ? stdout : stderr, stats.accesses);
+        delete profiler;
+    }
 
     // Free file stream (if applicable)
     if (file)
         delete fs;
 
+    delete args.chunked;
+
     return 0;
 }
@@ -24,11 +24,76 @@ struct cache_stats_t {
     uint64_t subblock_misses;
 
 	uint64_t bytes_transferred;
+
+    // Prefetcher (see prefetch.hpp)
+    uint64_t prefetches;      // Blocks fetched by the prefetcher
+    uint64_t prefetch_hits;   // Prefetched blocks used by a demand access
+    uint64_t stream_hits;     // Demand misses served by a stream buffer
+    uint64_t prefetch_unused; // Prefetched blocks dropped before use (pollution)
+    uint64_t prefetch_bytes;  // Prefetch traffic (included in bytes_transferred)
+
+    // Write policy and write buffer (see writebuf.hpp)
+    uint64_t write_throughs;     // Subblocks written through to memory
+    uint64_t write_bypasses;     // No-write-allocate misses (not cached)
+    uint64_t wbuf_writes;        // Write buffer entries allocated
+    uint64_t wbuf_coalesced;     // Writes merged into a buffered entry
+    uint64_t wbuf_stalls;        // Writes that found the buffer full
+    uint64_t wbuf_max_occupancy;
+    uint64_t wbuf_occupancy_sum; // Sum of per-access occupancy samples
+
+    // Memory backend (see memory.hpp)
+    uint64_t mem_reads;      // Demand fills from memory
+    uint64_t mem_writes;     // Writes reaching memory
+    uint64_t mshr_merges;    // Misses merged into an outstanding MSHR
+    uint64_t mshr_stalls;    // Misses that found every MSHR busy
+    uint64_t row_hits;       // DRAM row buffer hits
+    uint64_t row_misses;     // DRAM accesses to a closed bank
+    uint64_t row_conflicts;  // DRAM accesses that had to close another row
+
+    // Shared cache (see partition.hpp)
+    uint64_t evicted_by_others; // Blocks evicted by another program's fill
+
+    // Set index function (see indexing.hpp)
+    uint64_t sets_used;         // Sets that received at least one fill
+
+    // Access sizes and PC-aware replacement (see replacement.hpp)
+    uint64_t split_accesses;     // Records spanning more than one block
+    uint64_t predicted_dead;     // Blocks moved to LRU as predicted dead
+    uint64_t dead_mispredictions; // Hits on blocks predicted dead
+
+    // Address translation (see tlb.hpp)
+    uint64_t tlb_l1_misses;   // Translations missing the L1 TLB
+    uint64_t tlb_walks;       // ... and the L2 TLB: page walks
+    uint64_t pwc_hits;        // Walks shortened by the page-walk cache
+    uint64_t walk_accesses;   // Page table reads sent to the cache
+    uint64_t walk_misses;     // ... that missed
+    uint64_t thp_promotions;  // 2M regions promoted to huge pages
+
+    // Sectored and compressed caches (see organization.hpp)
+    uint64_t metadata_bits;   // Tag and pointer storage
    
 	double   hit_time;
     double   miss_penalty;
     double   miss_rate;
     double   avg_access_time;
+
+    double   prefetch_accuracy; // prefetch_hits / prefetches
+    double   prefetch_coverage; // prefetch_hits / (prefetch_hits + remaining misses)
+
+    double   write_stall_cycles; // Cycles stalled on writes to memory
+    double   wbuf_occupancy;     // Average write buffer occupancy
+    double   wbuf_coalesce_rate; // wbuf_coalesced / buffered writes
+
+    double   miss_cycles;        // Total demand miss latency
+    double   mshr_stall_cycles;  // Cycles blocked on full MSHRs
+
+    double   set_fill_imbalance; // Fills into the busiest set / mean per set
+
+    double   translation_cycles; // L2 TLB lookups and page walks (in the AAT)
+
+    double   effective_capacity; // Average bytes of valid (uncompressed) data held
+    double   capacity_ratio;     // effective_capacity / physical data capacity
+    double   metadata_ratio;     // metadata_bits / a conventional cache's
 };
 
 static const uint64_t DEFAULT_C = 15;   /* 64KB Cache */
@@ -41,5 +106,26 @@ static const uint64_t DEFAULT_K = 3;	/* 8 byte sub-blocks */
 static const char     READ = 'r';
 /** Argument to cache_access rw. Indicates a store */
 static const char     WRITE = 'w';
+/** Reduced traces: repeated hits to the previous record's block */
+static const char     REPEAT = 'h';
+
+/** A single decoded trace record (16 bytes) */
+struct Access {
+    u64 addr;      // REPEAT: packed counts (see make_repeat())
+    char mode;     // READ, WRITE or REPEAT
+    uint16_t size; // Bytes accessed (0 = unknown, treated as 1)
+    uint32_t pc;   // Low bits of the instruction address (0 = unknown)
+};
+
+// Largest count a single REPEAT record holds
+static const u64 REPEAT_MAX = 0xffffffff;
+
+// REPEAT records keep reads in the high half of `addr`, writes in the low
+inline Access make_repeat(u64 reads, u64 writes) {
+    return {(reads << 32) | writes, REPEAT};
+}
+
+inline u64 repeat_reads(const Access& a) { return a.addr >> 32; }
+inline u64 repeat_writes(const Access& a) { return a.addr & REPEAT_MAX; }
 
 #endif /* CACHESIM_H */
@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include "chunktrace.hpp"
+#include "util.hpp" // exit_on_error
+
+// C includes
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char HEADER_MAGIC[4] = {'C', 'T', 'R', 'C'};
+static const char FOOTER_MAGIC[4] = {'C', 'T', 'R', 'X'};
+static const uint32_t VERSION = 2; // 2: PC and size in escaped records
+
+static const u64 HEADER_BYTES = 12;
+static const u64 TRAILER_BYTES = 20;
+
+// Record tags (low two bits of the first varint)
+enum RecordTag {
+    TAG_READ = 0,    // Delta-coded read
+    TAG_WRITE = 1,   // Delta-coded write
+    TAG_REPEAT = 2,  // Followed by reads and writes
+    TAG_ABSOLUTE = 3 // Escape: flags byte, then the address (and PC and size)
+};
+
+// Flags byte of an escaped record (low two bits: TAG_READ or TAG_WRITE)
+static const unsigned char FLAG_EXTENDED = 4; // PC and size follow the address
+static const unsigned char FLAG_DELTA = 8;    // Address is a zigzag delta
+
+static inline void put_varint(std::vector<unsigned char>& buf, u64 v) {
+    while (v >= 0x80) {
+        buf.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+
+    buf.push_back(static_cast<unsigned char>(v));
+}
+
+static inline u64 get_varint(const unsigned char*& p, const unsigned char* end) {
+    u64 v = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end)
+            break;
+
+        unsigned char b = *p++;
+        v |= static_cast<u64>(b & 0x7f) << shift;
+
+        if (!(b & 0x80))
+            return v;
+    }
+
+    exit_on_error("Corrupt chunked trace.");
+    return 0;
+}
+
+static inline u64 zigzag(u64 delta) {
+    return (delta << 1) ^ static_cast<u64>(static_cast<int64_t>(delta) >> 63);
+}
+
+static inline u64 unzigzag(u64 v) {
+    return (v >> 1) ^ (~(v & 1) + 1);
+}
+
+// Read exactly `n` bytes at `offset`
+static void read_at(int fd, void* out, u64 n, u64 offset) {
+    char* p = static_cast<char*>(out);
+
+    while (n > 0) {
+        ssize_t got = pread(fd, p, n, offset);
+
+        if (got <= 0)
+            exit_on_error("Corrupt chunked trace.");
+
+        p += got;
+        n -= got;
+        offset += got;
+    }
+}
+
+bool is_chunked_trace(const std::string& path) {
+    char magic[4];
+    FILE* f = fopen(path.c_str(), "rb");
+
+    if (f == nullptr)
+        return false;
+
+    bool chunked = fread(magic, sizeof(magic), 1, f) == 1 &&
+                   memcmp(magic, HEADER_MAGIC, sizeof(magic)) == 0;
+
+    fclose(f);
+
+    return chunked;
+}
+
+ChunkedTraceWriter::ChunkedTraceWriter(const std::string& path, u64 chunk_records, u64 reduced_B) :
+            chunk_records(chunk_records), offset(HEADER_BYTES) {
+    if (chunk_records == 0)
+        exit_on_error("Chunks need at least one record.");
+
+    f = fopen(path.c_str(), "wb");
+
+    if (f == nullptr)
+        exit_on_error("Could not open output file.");
+
+    uint32_t version = VERSION, B = static_cast<uint32_t>(reduced_B);
+
+    fwrite(HEADER_MAGIC, sizeof(HEADER_MAGIC), 1, f);
+    fwrite(&version, sizeof(version), 1, f);
+    fwrite(&B, sizeof(B), 1, f);
+}
+
+ChunkedTraceWriter::~ChunkedTraceWriter() {
+    if (f != nullptr)
+        close();
+}
+
+void ChunkedTraceWriter::push(const Access& a) {
+    // A chunk starts at its first address so it decodes on its own
+    if (records == 0) {
+        index.push_back({offset, 0, 0, total, a.mode == REPEAT ? 0 : a.addr});
+        prev = index.back().first_addr;
+    }
+
+    if (a.mode == REPEAT) {
+        put_varint(buf, TAG_REPEAT);
+        put_varint(buf, repeat_reads(a));
+        put_varint(buf, repeat_writes(a));
+    } else {
+        u64 z = zigzag(a.addr - prev);
+        u64 tag = (a.mode == WRITE) ? TAG_WRITE : TAG_READ;
+
+        if (a.pc != 0 || a.size != 0) {
+            put_varint(buf, TAG_ABSOLUTE);
+            buf.push_back(static_cast<unsigned char>(tag | FLAG_EXTENDED | FLAG_DELTA));
+            put_varint(buf, z);
+            put_varint(buf, a.pc);
+            put_varint(buf, a.size);
+        } else if (z >> 62 == 0) {
+            put_varint(buf, (z << 2) | tag);
+        } else {
+            put_varint(buf, TAG_ABSOLUTE);
+            buf.push_back(static_cast<unsigned char>(tag));
+            put_varint(buf, a.addr);
+        }
+
+        prev = a.addr;
+    }
+
+    records++;
+    total++;
+
+    if (records == chunk_records)
+        flush_chunk();
+}
+
+void ChunkedTraceWriter::flush_chunk() {
+    if (records == 0)
+        return;
+
+    if (fwrite(buf.data(), 1, buf.size(), f) != buf.size())
+        exit_on_error("Could not write chunked trace.");
+
+    index.back().bytes = buf.size();
+    index.back().records = records;
+
+    offset += buf.size();
+    buf.clear();
+    records = 0;
+}
+
+void ChunkedTraceWriter::close() {
+    flush_chunk();
+
+    u64 n = index.size();
+
+    fwrite(index.data(), sizeof(ChunkInfo), n, f);
+    fwrite(&n, sizeof(n), 1, f);
+    fwrite(&offset, sizeof(offset), 1, f);
+    fwrite(FOOTER_MAGIC, sizeof(FOOTER_MAGIC), 1, f);
+
+    if (fclose(f) != 0)
+        exit_on_error("Could not write chunked trace.");
+
+    f = nullptr;
+}
+
+ChunkedTrace::ChunkedTrace(const std::string& path) {
+    fd = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        exit_on_error("File not found.");
+
+    off_t size = lseek(fd, 0, SEEK_END);
+
+    if (size < static_cast<off_t>(HEADER_BYTES + TRAILER_BYTES))
+        exit_on_error("Corrupt chunked trace.");
+
+    char magic[4];
+    uint32_t version, B;
+
+    read_at(fd, magic, sizeof(magic), 0);
+    read_at(fd, &version, sizeof(version), 4);
+    read_at(fd, &B, sizeof(B), 8);
+
+    if (memcmp(magic, HEADER_MAGIC, sizeof(magic)) != 0 || version < 1 || version > VERSION)
+        exit_on_error("Not a chunked trace (or unsupported version).");
+
+    reduced_B = B;
+
+    u64 n, index_offset;
+    u64 trailer = size - TRAILER_BYTES;
+
+    read_at(fd, &n, sizeof(n), trailer);
+    read_at(fd, &index_offset, sizeof(index_offset), trailer + 8);
+    read_at(fd, magic, sizeof(magic), trailer + 16);
+
+    if (memcmp(magic, FOOTER_MAGIC, sizeof(magic)) != 0 ||
+            index_offset + n * sizeof(ChunkInfo) != trailer)
+        exit_on_error("Corrupt chunked trace.");
+
+    index.resize(n);
+    read_at(fd, index.data(), n * sizeof(ChunkInfo), index_offset);
+
+    for (auto& c: index)
+        total += c.records;
+}
+
+ChunkedTrace::~ChunkedTrace() {
+    ::close(fd);
+}
+
+size_t ChunkedTrace::find_chunk(u64 n) const {
+    // Last chunk starting at or before `n`
+    auto it = std::upper_bound(index.begin(), index.end(), n,
+        [](u64 v, const ChunkInfo& c) { return v < c.first_record; });
+
+    return (it == index.begin()) ? 0 : (it - index.begin()) - 1;
+}
+
+void ChunkedTrace::decode(size_t i, std::vector<Access>& out) const {
+    const ChunkInfo& c = index[i];
+    std::vector<unsigned char> buf(c.bytes);
+
+    read_at(fd, buf.data(), c.bytes, c.offset);
+
+    const unsigned char* p = buf.data();
+    const unsigned char* end = p + buf.size();
+    u64 prev = c.first_addr;
+
+    out.reserve(out.size() + c.records);
+
+    for (u64 r = 0; r < c.records; r++) {
+        u64 v = get_varint(p, end);
+
+        switch (v & 3) {
+            case TAG_READ:
+            case TAG_WRITE:
+                prev += unzigzag(v >> 2);
+                out.push_back({prev, (v & 3) == TAG_WRITE ? WRITE : READ});
+                break;
+            case TAG_REPEAT: {
+                u64 reads = get_varint(p, end);
+                u64 writes = get_varint(p, end);
+                out.push_back(make_repeat(reads, writes));
+                break;
+            }
+            default: {
+                if (p == end)
+                    exit_on_error("Corrupt chunked trace.");
+
+                unsigned char flags = *p++;
+                char mode = ((flags & 3) == TAG_WRITE) ? WRITE : READ;
+                u64 v = get_varint(p, end);
+
+                prev = (flags & FLAG_DELTA) ? prev + unzigzag(v) : v;
+
+                if (flags & FLAG_EXTENDED) {
+                    u64 pc = get_varint(p, end);
+                    u64 size = get_varint(p, end);
+                    out.push_back({prev, mode, static_cast<uint16_t>(size), static_cast<uint32_t>(pc)});
+                } else {
+                    out.push_back({prev, mode});
+                }
+            }
+        }
+    }
+}
+
+void ChunkedTrace::read(u64 begin, u64 end, std::vector<Access>& out, int threads) const {
+    end = std::min(end, total);
+
+    if (begin >= end)
+        return;
+
+    size_t first = find_chunk(begin), last = find_chunk(end - 1);
+    size_t n = last - first + 1;
+
+    // Decode whole chunks (in parallel), then trim to the window
+    std::vector<std::vector<Access>> parts(n);
+    threads = std::max(1, std::min(threads, static_cast<int>(n)));
+
+    auto work = [&](size_t t) {
+        for (size_t i = t; i < n; i += threads)
+            decode(first + i, parts[i]);
+    };
+
+    std::vector<std::thread> pool;
+
+    for (int t = 1; t < threads; t++)
+        pool.emplace_back(work, t);
+
+    work(0);
+
+    for (auto& t: pool)
+        t.join();
+
+    u64 skip = begin - index[first].first_record;
+    u64 want = end - begin;
+
+    out.reserve(out.size() + want);
+
+    for (size_t i = 0; i < n && want > 0; i++) {
+        size_t from = (i == 0) ? skip : 0;
+        size_t len = std::min<u64>(want, parts[i].size() - from);
+
+        out.insert(out.end(), parts[i].begin() + from, parts[i].begin() + from + len);
+        want -= len;
+    }
+}
+
+void ChunkedTraceReader::seek(u64 n) {
+    chunk.clear();
+    pos = 0;
+
+    if (n >= trace->records()) {
+        next_chunk = trace->chunks();
+        return;
+    }
+
+    next_chunk = trace->find_chunk(n);
+    refill();
+    pos = n - trace->chunk(next_chunk - 1).first_record;
+}
+
+bool ChunkedTraceReader::refill() {
+    if (next_chunk >= trace->chunks())
+        return false;
+
+    chunk.clear();
+    pos = 0;
+    trace->decode(next_chunk++, chunk);
+
+    return true;
+}
+
+bool ChunkedTraceReader::next(Access& a) {
+    while (pos == chunk.size()) {
+        if (!refill())
+            return false;
+    }
+
+    a = chunk[pos++];
+    return true;
+}
+
+size_t ChunkedTraceReader::next_batch(Access* out, size_t n) {
+    size_t i = 0;
+
+    while (i < n) {
+        if (pos == chunk.size() && !refill())
+            break;
+
+        size_t len = std::min(n - i, chunk.size() - pos);
+        std::copy(chunk.begin() + pos, chunk.begin() + pos + len, out + i);
+
+        i += len;
+        pos += len;
+    }
+
+    return i;
+}
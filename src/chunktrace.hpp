@@ -0,0 +1,123 @@
+#ifndef CHUNKTRACE_H
+#define CHUNKTRACE_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cachesim.hpp"
+#include "trace.hpp"
+
+/**
+    Chunked binary trace container.
+
+    Records are grouped into chunks that decode independently: each record
+    is a varint of its address delta from the previous record in the chunk
+    (the first from the chunk's first address), tagged with the mode.
+    Records with a PC or size are escaped and carry both as varints.
+    A footer index gives every chunk's file offset, size, record count,
+    first record number and first address, so any record can be reached
+    without decoding what precedes it, and chunks can be decoded by
+    several threads at once.
+
+    Layout (little-endian):
+        "CTRC" u32 version u32 reduced_B
+        chunk data...
+        index: num_chunks x ChunkInfo
+        u64 num_chunks, u64 index offset, "CTRX"
+*/
+struct ChunkInfo {
+    u64 offset;        // File offset of the chunk data
+    u64 bytes;         // Encoded size
+    u64 records;       // Records in the chunk
+    u64 first_record;  // Number of the chunk's first record in the trace
+    u64 first_addr;    // Address the deltas start from
+};
+
+// Records per chunk unless told otherwise
+static const u64 DEFAULT_CHUNK_RECORDS = 65536;
+
+// Does `path` hold a chunked trace? (checks the magic)
+bool is_chunked_trace(const std::string& path);
+
+/**
+    Writes a chunked trace; records are encoded as they are pushed.
+*/
+class ChunkedTraceWriter {
+public:
+    // `reduced_B` is the block size of a reduced trace (0 = not reduced)
+    ChunkedTraceWriter(const std::string& path, u64 chunk_records = DEFAULT_CHUNK_RECORDS,
+                       u64 reduced_B = 0);
+    ~ChunkedTraceWriter();
+
+    void push(const Access& a);
+
+    // Flush the last chunk and write the index
+    void close();
+
+private:
+    FILE* f;
+    u64 chunk_records;
+    std::vector<ChunkInfo> index;
+    std::vector<unsigned char> buf; // Current chunk
+    u64 records = 0;                // In the current chunk
+    u64 total = 0;
+    u64 prev = 0;                   // Last address in the current chunk
+    u64 offset;                     // Where the current chunk starts
+
+    void flush_chunk();
+};
+
+/**
+    Read-only view of a chunked trace. Decoding is thread-safe.
+*/
+class ChunkedTrace {
+public:
+    ChunkedTrace(const std::string& path);
+    ~ChunkedTrace();
+
+    u64 records() const { return total; }
+    u64 block_bits() const { return reduced_B; }
+
+    size_t chunks() const { return index.size(); }
+    const ChunkInfo& chunk(size_t i) const { return index[i]; }
+
+    // Chunk holding record `n`
+    size_t find_chunk(u64 n) const;
+
+    // Decode chunk `i`, appending to `out`
+    void decode(size_t i, std::vector<Access>& out) const;
+
+    // Decode records [begin, end), spreading chunks over `threads` threads
+    void read(u64 begin, u64 end, std::vector<Access>& out, int threads = 1) const;
+
+private:
+    int fd;
+    u64 total = 0;
+    u64 reduced_B = 0;
+    std::vector<ChunkInfo> index;
+};
+
+/**
+    Streams a chunked trace from any record, one chunk at a time.
+*/
+class ChunkedTraceReader : public AccessSource {
+public:
+    ChunkedTraceReader(const ChunkedTrace* trace) : trace(trace) {}
+
+    // Continue from record `n`
+    void seek(u64 n);
+
+    bool next(Access& a) override;
+    size_t next_batch(Access* out, size_t n) override;
+
+private:
+    const ChunkedTrace* trace;
+    size_t next_chunk = 0;
+    std::vector<Access> chunk; // Decoded current chunk
+    size_t pos = 0;
+
+    bool refill();
+};
+
+#endif
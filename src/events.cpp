@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <chrono>
+
+#include "events.hpp"
+#include "util.hpp" // exit_on_error
+
+EventWriter::EventWriter(const std::string& path, size_t slots) : head(0), tail(0), done(false) {
+    size_t n = 1;
+
+    while (n < slots)
+        n <<= 1;
+
+    ring.resize(n);
+    mask = n - 1;
+
+    out = fopen(path.c_str(), "wb");
+
+    if (out == nullptr)
+        exit_on_error("Could not open event file.");
+
+    worker = std::thread(&EventWriter::run, this);
+}
+
+EventWriter::~EventWriter() {
+    close();
+}
+
+void EventWriter::close() {
+    if (!worker.joinable())
+        return;
+
+    done.store(true, std::memory_order_release);
+    worker.join();
+
+    fclose(out);
+}
+
+void EventWriter::run() {
+    while (true) {
+        // Read `done` first: once it is set, `tail` is final
+        bool finished = done.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_acquire);
+        size_t h = head.load(std::memory_order_relaxed);
+
+        if (t == h) {
+            if (finished)
+                break;
+
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            continue;
+        }
+
+        // Up to two contiguous runs of slots (the ring may wrap)
+        while (h != t) {
+            size_t start = h & mask;
+            size_t len = std::min(t - h, ring.size() - start);
+
+            if (fwrite(&ring[start], sizeof(AccessEvent), len, out) != len)
+                exit_on_error("Could not write event file.");
+
+            h += len;
+            head.store(h, std::memory_order_release);
+        }
+    }
+}
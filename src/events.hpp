@@ -0,0 +1,127 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cache.hpp"
+#include "cachesim.hpp"
+
+/**
+    One traced access, as written to the event file (32 bytes, host byte
+    order, no header). REPEAT records produce one event whose `addr` holds
+    the packed counts (see make_repeat()).
+*/
+struct AccessEvent {
+    u64 index;        // Trace record number (counting records skipped)
+    u64 addr;
+    u64 victim;       // Block address evicted from the cache (if `evicted`)
+    char mode;        // READ, WRITE or REPEAT
+    uint8_t result;   // CacheResult
+    uint8_t evicted;  // The access evicted a valid block
+    uint8_t writeback;// The access caused a writeback to memory
+    uint32_t pad;
+};
+
+/**
+    Single-producer single-consumer ring of events, drained to a file by a
+    background thread. The simulation thread only copies an event into a
+    slot and publishes it; when the ring is full it waits for the writer
+    rather than dropping events.
+*/
+class EventWriter {
+public:
+    // `slots` is rounded up to a power of two
+    EventWriter(const std::string& path, size_t slots = 1 << 16);
+    ~EventWriter();
+
+    inline void push(const AccessEvent& e) {
+        size_t t = tail.load(std::memory_order_relaxed);
+
+        while (t - head.load(std::memory_order_acquire) == ring.size())
+            std::this_thread::yield();
+
+        ring[t & mask] = e;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    // Write out everything pushed and stop the writer thread
+    void close();
+
+private:
+    FILE* out;
+    std::vector<AccessEvent> ring;
+    size_t mask;
+
+    // Producer and consumer indices on separate cache lines
+    std::atomic<size_t> head;
+    char pad_head[64];
+    std::atomic<size_t> tail;
+    char pad_tail[64];
+
+    std::atomic<bool> done;
+    std::thread worker;
+
+    void run();
+};
+
+/**
+    Event sink policies for the simulation loop. Each record calls
+    record(); with NullSink the call and everything it reads vanish, so
+    the untraced loop is unchanged. EventSink learns of evictions through
+    the cache's eviction hook, which untraced caches do not have.
+*/
+struct NullSink {
+    inline void record(const Access& a, CacheResult cr, const cache_stats_t& stats) {}
+};
+
+class EventSink {
+public:
+    // `first` numbers the first record (e.g. the records skipped)
+    EventSink(EventWriter* writer, Cache& cache, u64 first = 0) : writer(writer), cache(cache), first(first) {
+        cache.set_evict_hook(&EventSink::on_evict, this);
+    }
+
+    ~EventSink() {
+        cache.set_evict_hook(nullptr, nullptr);
+    }
+
+    inline void record(const Access& a, CacheResult cr, const cache_stats_t& stats) {
+        AccessEvent e;
+
+        e.index = first + index++;
+        e.addr = a.addr;
+        e.mode = a.mode;
+        e.result = static_cast<uint8_t>(cr);
+        e.evicted = evicted;
+        e.victim = evicted ? victim : 0;
+        e.writeback = stats.write_backs != write_backs;
+        e.pad = 0;
+
+        writer->push(e);
+
+        // Counters only move inside accesses, so these are the "before"
+        // values for the next one
+        evicted = false;
+        write_backs = stats.write_backs;
+    }
+
+private:
+    EventWriter* writer;
+    Cache& cache;
+    u64 first;
+    u64 index = 0, write_backs = 0;
+    bool evicted = false;
+    u64 victim = 0;                // Latest block evicted by this record
+
+    static void on_evict(void* user, u64 block_addr, bool dirty) {
+        EventSink* sink = static_cast<EventSink*>(user);
+        sink->evicted = true;
+        sink->victim = block_addr;
+    }
+};
+
+#endif
@@ -0,0 +1,34 @@
+#include "indexing.hpp"
+#include "util.hpp" // exit_on_error
+
+IndexFunction parse_index(const std::string& spec) {
+    if (spec == "bits")
+        return INDEX_BITS;
+    if (spec == "xor")
+        return INDEX_XOR;
+    if (spec == "prime")
+        return INDEX_PRIME;
+    if (spec == "skew")
+        return INDEX_SKEW;
+
+    exit_on_error("Unknown index function: " + spec);
+    return INDEX_BITS;
+}
+
+u64 largest_prime(u64 n) {
+    for (; n > 2; n--) {
+        bool prime = true;
+
+        for (u64 d = 2; d * d <= n; d++) {
+            if (n % d == 0) {
+                prime = false;
+                break;
+            }
+        }
+
+        if (prime)
+            return n;
+    }
+
+    return 2;
+}
@@ -0,0 +1,58 @@
+#ifndef INDEXING_H
+#define INDEXING_H
+
+#include <string>
+
+#include "cachesim.hpp"
+
+/**
+    Set index functions. All of them take the block address (address
+    without the offset bits) and produce a set in [0, 2^bits).
+
+    Anything but INDEX_BITS makes the tag the whole block address, since
+    the index no longer determines any address bits.
+*/
+enum IndexFunction {
+    INDEX_BITS,   // Low block address bits (the classic bitfield)
+    INDEX_XOR,    // All block address bits XOR-folded down to `bits`
+    INDEX_PRIME,  // Block address modulo the largest prime <= 2^bits
+    INDEX_SKEW    // Skewed-associative: a different hash for every way
+};
+
+// Parse "bits", "xor", "prime" or "skew"
+IndexFunction parse_index(const std::string& spec);
+
+// Largest prime <= n (n >= 2)
+u64 largest_prime(u64 n);
+
+inline u64 xor_fold(u64 block, u64 bits) {
+    if (bits == 0)
+        return 0;
+
+    u64 mask = (static_cast<u64>(1) << bits) - 1;
+    u64 index = 0;
+
+    for (; block != 0; block >>= bits)
+        index ^= block & mask;
+
+    return index;
+}
+
+// Way `way` of a skewed cache: multiplicative hash with a per-way constant
+inline u64 skew_hash(u64 block, int way, u64 bits) {
+    static const u64 MULTIPLIERS[] = {
+        0x9e3779b97f4a7c15, 0xc2b2ae3d27d4eb4f, 0x165667b19e3779f9, 0xd6e8feb86659fd93,
+        0xff51afd7ed558ccd, 0xc4ceb9fe1a85ec53, 0x94d049bb133111eb, 0xbf58476d1ce4e5b9,
+    };
+
+    if (bits == 0)
+        return 0;
+
+    // Salt before the multiply, so ways w and w + 8 collide independently
+    u64 x = block ^ (static_cast<u64>(way / 8) * 0x2545f4914f6cdd1d);
+    u64 h = (x ^ (x >> 29)) * MULTIPLIERS[way % 8];
+
+    return h >> (64 - bits);
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include "cache.hpp"
+#include "indexing.hpp"
+#include "libcachesim.h"
+#include "memory.hpp"
+#include "prefetch.hpp"
+#include "replacement.hpp"
+#include "stats.hpp"
+#include "util.hpp" // exit_on_error
+
+// Records are handed to Cache::access_batch() as they are
+static_assert(sizeof(cachesim_access) == sizeof(Access), "cachesim_access layout");
+static_assert(offsetof(cachesim_access, mode) == offsetof(Access, mode), "cachesim_access layout");
+static_assert(offsetof(cachesim_access, size) == offsetof(Access, size), "cachesim_access layout");
+static_assert(offsetof(cachesim_access, pc) == offsetof(Access, pc), "cachesim_access layout");
+
+struct cachesim_cache {
+    cache_stats_t stats = {};
+
+    // Owned, so a create that fails partway frees what it made; the cache
+    // goes first since it uses the others
+    std::unique_ptr<Prefetcher> prefetcher;
+    std::unique_ptr<MemoryBackend> memory;
+    std::unique_ptr<ReplacementPredictor> replacement;
+    std::unique_ptr<Cache> cache;
+
+    cachesim_evict_fn evict_fn = nullptr;
+    void* evict_user = nullptr;
+};
+
+static thread_local std::string last_error;
+static std::once_flag handler_set;
+
+// Errors unwind back to the API boundary instead of exiting
+static void throw_error(const std::string& msg) {
+    throw std::runtime_error(msg);
+}
+
+// Run `body`; on an error, record it and return -1
+template <class F>
+static int guarded(F body) {
+    // The handler is process-wide: install it once, not on every call
+    std::call_once(handler_set, []() { set_error_handler(throw_error); });
+
+    try {
+        body();
+        return 0;
+    } catch (const std::exception& e) {
+        last_error = e.what();
+        return -1;
+    }
+}
+
+static bool has(const char* spec) {
+    return spec != nullptr && spec[0] != '\0';
+}
+
+static void forward_eviction(void* user, u64 block_addr, bool dirty) {
+    cachesim_cache* c = static_cast<cachesim_cache*>(user);
+    c->evict_fn(c->evict_user, block_addr, dirty ? 1 : 0);
+}
+
+extern "C" {
+
+int cachesim_api_version(void) {
+    return CACHESIM_API_VERSION;
+}
+
+const char* cachesim_last_error(void) {
+    return last_error.c_str();
+}
+
+void cachesim_config_init(cachesim_config* config) {
+    *config = cachesim_config();
+
+    config->C = DEFAULT_C;
+    config->B = DEFAULT_B;
+    config->S = DEFAULT_S;
+    config->K = DEFAULT_K;
+    config->V = DEFAULT_V;
+}
+
+cachesim_cache* cachesim_create(const cachesim_config* config) {
+    std::unique_ptr<cachesim_cache> c(new cachesim_cache());
+
+    int status = guarded([&]() {
+        CacheSize size = {config->C, config->B, config->S, config->K, config->V};
+
+        if (size.B > size.C)
+            exit_on_error("B cannot be greater than C.");
+
+        c->cache.reset(new Cache(size, find_cache_type(size), &c->stats));
+
+        if (has(config->write))
+            c->cache->set_write_config(parse_write_config(config->write));
+
+        if (has(config->index))
+            c->cache->set_index_function(parse_index(config->index));
+
+        if (has(config->memory)) {
+            c->memory.reset(make_memory(config->memory, size.B));
+            c->cache->set_memory(c->memory.get());
+        }
+
+        if (has(config->replacement)) {
+            c->replacement.reset(make_replacement(config->replacement));
+            c->cache->set_replacement(c->replacement.get());
+        }
+
+        if (has(config->prefetcher)) {
+            c->prefetcher.reset(make_prefetcher(config->prefetcher, size.B));
+            c->cache->set_prefetcher(c->prefetcher.get());
+        }
+    });
+
+    if (status != 0)
+        return nullptr;
+
+    return c.release();
+}
+
+void cachesim_destroy(cachesim_cache* cache) {
+    delete cache;
+}
+
+int cachesim_access_batch(cachesim_cache* cache, const cachesim_access* accesses, size_t n) {
+    return guarded([&]() {
+        cache->cache->access_batch(reinterpret_cast<const Access*>(accesses), n);
+    });
+}
+
+void cachesim_set_evict_callback(cachesim_cache* cache, cachesim_evict_fn fn, void* user) {
+    cache->evict_fn = fn;
+    cache->evict_user = user;
+    cache->cache->set_evict_hook(fn != nullptr ? forward_eviction : nullptr, cache);
+}
+
+int cachesim_get_stats(cachesim_cache* cache, cachesim_stats* out) {
+    if (cache->stats.accesses == 0) {
+        last_error = "No accesses simulated yet.";
+        return -1;
+    }
+
+    cache->cache->compute_stats();
+
+    const cache_stats_t& s = cache->stats;
+
+    out->accesses = s.accesses;
+    out->reads = s.reads;
+    out->writes = s.writes;
+    out->read_misses = s.read_misses;
+    out->write_misses = s.write_misses;
+    out->misses = s.misses;
+    out->write_backs = s.write_backs;
+    out->vc_misses = s.vc_misses;
+    out->subblock_misses = s.subblock_misses;
+    out->bytes_transferred = s.bytes_transferred;
+    out->hit_time = s.hit_time;
+    out->miss_penalty = s.miss_penalty;
+    out->miss_rate = s.miss_rate;
+    out->avg_access_time = s.avg_access_time;
+
+    return 0;
+}
+
+int cachesim_stat(cachesim_cache* cache, const char* name, double* value) {
+    if (cache->stats.accesses > 0)
+        cache->cache->compute_stats();
+
+    if (!find_stat(cache->stats, name, *value)) {
+        last_error = std::string("Unknown statistic: ") + name;
+        return -1;
+    }
+
+    return 0;
+}
+
+}
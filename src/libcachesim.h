@@ -0,0 +1,86 @@
+#ifndef LIBCACHESIM_H
+#define LIBCACHESIM_H
+
+/*
+    C API of libcachesim: simulate a cache in-process, fed straight from
+    memory buffers.
+
+    Every function that can fail returns NULL or -1 and leaves a message
+    for cachesim_last_error() (per thread). Invalid configurations never
+    exit the host process. A cache handle must not be used by two threads
+    at once; separate handles are independent.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped on any incompatible change to the declarations below */
+#define CACHESIM_API_VERSION 1
+
+/* One access; same layout as the simulator's own records, so arrays of
+   them are simulated without copying */
+typedef struct {
+    uint64_t addr;
+    char mode;      /* 'r' or 'w' */
+    uint16_t size;  /* Bytes accessed (0 = unknown, treated as 1) */
+    uint32_t pc;    /* Low bits of the instruction address (0 = unknown) */
+} cachesim_access;
+
+/* Cache and memory configuration. Specs use the cachesim option syntax;
+   NULL or "" leaves the feature off. */
+typedef struct {
+    uint64_t C, B, S, K, V;   /* As cachesim -C -B -S -K -V (log2 sizes) */
+    const char* write;        /* -w: "wb", "wt", "nwa", with buffer options */
+    const char* prefetcher;   /* -p */
+    const char* memory;       /* -M: memory model below the cache */
+    const char* replacement;  /* -R */
+    const char* index;        /* -H */
+} cachesim_config;
+
+/* Headline statistics; others are available by name (cachesim_stat()) */
+typedef struct {
+    uint64_t accesses, reads, writes;
+    uint64_t read_misses, write_misses, misses;
+    uint64_t write_backs, vc_misses, subblock_misses;
+    uint64_t bytes_transferred;
+    double hit_time, miss_penalty, miss_rate, avg_access_time;
+} cachesim_stats;
+
+typedef struct cachesim_cache cachesim_cache;
+
+/* Called for every valid block evicted from the cache (into the victim
+   cache, if any) */
+typedef void (*cachesim_evict_fn)(void* user, uint64_t block_addr, int dirty);
+
+int cachesim_api_version(void);
+
+/* Message of the last failure on this thread */
+const char* cachesim_last_error(void);
+
+/* Defaults of the cachesim binary (64 KB, 32-byte blocks, 8-way, 4-entry VC) */
+void cachesim_config_init(cachesim_config* config);
+
+cachesim_cache* cachesim_create(const cachesim_config* config);
+void cachesim_destroy(cachesim_cache* cache);
+
+/* Simulate `n` accesses in order; 0 on success */
+int cachesim_access_batch(cachesim_cache* cache, const cachesim_access* accesses, size_t n);
+
+/* Report evictions to `fn` (NULL to stop) */
+void cachesim_set_evict_callback(cachesim_cache* cache, cachesim_evict_fn fn, void* user);
+
+/* Statistics so far (derived values included) */
+int cachesim_get_stats(cachesim_cache* cache, cachesim_stats* out);
+
+/* Any statistic by its CSV/JSON name, e.g. "prefetch_hits" */
+int cachesim_stat(cachesim_cache* cache, const char* name, double* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "lru.hpp"
 
 void LRU::push(u64 tag) {
@@ -58,3 +60,74 @@ u64 LRU::pop() {
     }
 }
 
+
+void LRU::order(std::vector<u64>& out) {
+    out.clear();
+
+    if (size == static_cast<size_t>(max_size))
+        out.push_back(last_popped);
+
+    // Stack is MRU first
+    size_t start = out.size();
+
+    for (auto t: stack)
+        out.push_back(t);
+
+    std::reverse(out.begin() + start, out.end());
+}
+
+void LRU::replace_victim(u64 tag) {
+    if (tag == last_popped)
+        return;
+
+    // Drop `tag` from the stack...
+    auto prev = stack.before_begin();
+
+    for (auto it = stack.begin(); it != stack.end(); prev = it++) {
+        if (*it == tag) {
+            stack.erase_after(prev);
+            break;
+        }
+    }
+
+    // ...and put the dropped tag back as the least recently used
+    auto last = stack.before_begin();
+
+    for (auto it = stack.begin(); it != stack.end(); ++it)
+        last = it;
+
+    stack.insert_after(last, last_popped);
+    last_popped = tag;
+}
+
+void LRU::demote(u64 tag) {
+    auto prev = stack.before_begin();
+    auto last = stack.before_begin();
+    bool found = false;
+
+    for (auto it = stack.begin(); it != stack.end(); prev = it++) {
+        if (*it == tag) {
+            stack.erase_after(prev);
+            found = true;
+            break;
+        }
+    }
+
+    if (!found)
+        return;
+
+    for (auto it = stack.begin(); it != stack.end(); ++it)
+        last = it;
+
+    stack.insert_after(last, tag);
+}
+
+void LRU::save_state(std::vector<u64>& out) const {
+    out.push_back(size);
+
+    for (auto t: stack)
+        out.push_back(t);
+
+    if (size == static_cast<size_t>(max_size))
+        out.push_back(last_popped);
+}
@@ -2,6 +2,7 @@
 #define CACHESIM_LRU_H
 
 #include <forward_list>
+#include <vector>
 
 #include "cachesim.hpp"
 
@@ -10,6 +11,21 @@ public:
     LRU(int m) : max_size(m) {}
     void push(u64 tag);
     u64 pop();
+
+    // Tags from least to most recently used, starting with the one the
+    // last overflowing push() dropped (if still pending)
+    void order(std::vector<u64>& out);
+
+    // Evict `tag` instead of the tag the last push() dropped, which goes
+    // back to the LRU end (partitioned replacement)
+    void replace_victim(u64 tag);
+
+    // Move `tag` to the LRU end (next to be replaced)
+    void demote(u64 tag);
+
+    // Append the stack, MRU first, then the tag the next pop() returns
+    // when the stack is full
+    void save_state(std::vector<u64>& out) const;
 private:
     // Using forward_list for efficiency
     std::forward_list<u64> stack;
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "memory.hpp"
+#include "util.hpp" // exit_on_error
+
+double FixedMemory::read(u64 block_addr, double now, double& stall) {
+    stall = latency;
+    return latency;
+}
+
+double FixedMemory::write(u64 block_addr, double now) {
+    stats->mem_writes++;
+    return latency;
+}
+
+DramMemory::DramMemory(const DramConfig& cfg) :
+            cfg(cfg), banks(cfg.banks), mshrs(cfg.mshrs) {
+    if (cfg.banks <= 0 || cfg.mshrs <= 0)
+        exit_on_error("DRAM needs at least one bank and one MSHR.");
+}
+
+double DramMemory::access(u64 block_addr, double now) {
+    // Consecutive rows interleave across banks
+    u64 row_addr = block_addr >> cfg.row_bits;
+    Bank& bank = banks[row_addr % banks.size()];
+    u64 row = row_addr / banks.size();
+
+    double start = std::max(now, bank.ready);
+    double core;
+
+    if (cfg.open_page) {
+        if (bank.open && bank.open_row == row) {
+            core = cfg.tCAS;
+            stats->row_hits++;
+        } else if (!bank.open) {
+            core = cfg.tRCD + cfg.tCAS;
+            stats->row_misses++;
+        } else {
+            core = cfg.tRP + cfg.tRCD + cfg.tCAS;
+            stats->row_conflicts++;
+        }
+
+        bank.open = true;
+        bank.open_row = row;
+    } else {
+        // Closed page: every access activates, then precharges in the background
+        core = cfg.tRCD + cfg.tCAS;
+        stats->row_misses++;
+    }
+
+    // Column reads to an open row pipeline: the bank is only busy for
+    // precharge/activate and the data burst, not for the CAS latency
+    bank.ready = start + (core - cfg.tCAS) + cfg.burst;
+
+    if (!cfg.open_page)
+        bank.ready += cfg.tRP;
+
+    return start + core + cfg.burst + cfg.ctrl;
+}
+
+double DramMemory::read(u64 block_addr, double now, double& stall) {
+    MSHR* free_mshr = nullptr;
+    MSHR* first_done = &mshrs[0];
+
+    stall = 0;
+
+    for (auto& m: mshrs) {
+        // Outstanding miss to the same block: merge
+        if (m.done > now && m.block == block_addr) {
+            stats->mshr_merges++;
+            return m.done - now;
+        }
+
+        if (m.done <= now && free_mshr == nullptr)
+            free_mshr = &m;
+
+        if (m.done < first_done->done)
+            first_done = &m;
+    }
+
+    // All MSHRs busy: block until the earliest one completes
+    if (free_mshr == nullptr) {
+        stall = first_done->done - now;
+        free_mshr = first_done;
+
+        stats->mshr_stalls++;
+        stats->mshr_stall_cycles += stall;
+    }
+
+    double done = access(block_addr, now + stall);
+
+    free_mshr->block = block_addr;
+    free_mshr->done = done;
+
+    return done - now;
+}
+
+void DramMemory::prefetch(u64 block_addr, double now) {
+    access(block_addr, now);
+}
+
+double DramMemory::write(u64 block_addr, double now) {
+    stats->mem_writes++;
+    return access(block_addr, now) - now;
+}
+
+MemoryBackend* make_memory(const std::string& spec, u64 B) {
+    SpecOptions opts;
+    std::string kind = parse_spec(spec, opts);
+
+    if (kind == "fixed") {
+        double latency = 100;
+
+        for (auto& kv: opts) {
+            if (kv.first == "latency")
+                latency = atof(kv.second.c_str());
+            else
+                exit_on_error("Unknown memory option: " + kv.first);
+        }
+
+        return new FixedMemory(latency);
+    } else if (kind == "dram") {
+        DramConfig cfg;
+
+        for (auto& kv: opts) {
+            const std::string& key = kv.first;
+            const std::string& val = kv.second;
+
+            if (key == "banks")
+                cfg.banks = atoi(val.c_str());
+            else if (key == "row")
+                cfg.row_bits = parse_log2(val, B, "row");
+            else if (key == "page" && (val == "open" || val == "closed"))
+                cfg.open_page = (val == "open");
+            else if (key == "tcas")
+                cfg.tCAS = atof(val.c_str());
+            else if (key == "trcd")
+                cfg.tRCD = atof(val.c_str());
+            else if (key == "trp")
+                cfg.tRP = atof(val.c_str());
+            else if (key == "burst")
+                cfg.burst = atof(val.c_str());
+            else if (key == "ctrl")
+                cfg.ctrl = atof(val.c_str());
+            else if (key == "mshrs")
+                cfg.mshrs = atoi(val.c_str());
+            else
+                exit_on_error("Unknown memory option: " + key + "=" + val);
+        }
+
+        return new DramMemory(cfg);
+    }
+
+    exit_on_error("Unknown memory model: " + kind);
+    return nullptr;
+}
@@ -0,0 +1,101 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <string>
+#include <vector>
+
+#include "cachesim.hpp"
+
+/**
+    Main memory behind a Cache. Supplies the latency of every fill
+    instead of the fixed miss penalty.
+
+    Times are in CPU cycles on the cache's clock (see Cache::tick()).
+*/
+class MemoryBackend {
+public:
+    virtual ~MemoryBackend() {}
+
+    // Called by Cache::set_memory()
+    void attach(cache_stats_t* stats) { this->stats = stats; }
+
+    // Demand fill of a block at time `now`. Returns the miss latency;
+    // `stall` is set to the cycles the cache itself is blocked.
+    virtual double read(u64 block_addr, double now, double& stall) = 0;
+
+    // Prefetch fill: occupies memory but nobody waits for it
+    virtual void prefetch(u64 block_addr, double now) = 0;
+
+    // Writeback / write-through; returns the cycles until it completes
+    virtual double write(u64 block_addr, double now) = 0;
+
+protected:
+    cache_stats_t* stats = nullptr;
+};
+
+// Constant latency; the cache blocks for the whole miss
+class FixedMemory : public MemoryBackend {
+public:
+    FixedMemory(double latency) : latency(latency) {}
+
+    double read(u64 block_addr, double now, double& stall) override;
+    void prefetch(u64 block_addr, double now) override {}
+    double write(u64 block_addr, double now) override;
+
+private:
+    double latency;
+};
+
+struct DramConfig {
+    int banks = 8;
+    u64 row_bits = 13;     // 8 KB row buffer
+    bool open_page = true; // Keep rows open after an access
+    double tCAS = 40;      // Column access (cycles)
+    double tRCD = 40;      // Row activate
+    double tRP = 40;       // Precharge
+    double burst = 8;      // Data transfer per block
+    double ctrl = 20;      // Controller and bus overhead
+    int mshrs = 8;         // Outstanding demand misses
+};
+
+/**
+    Banked DRAM with per-bank row buffers behind a set of MSHRs.
+
+    A demand miss takes an MSHR until its data returns; a miss to a block
+    already outstanding merges into that MSHR and only waits for the
+    remainder. When every MSHR is busy the cache stalls until one frees.
+    Accesses to a busy bank queue behind it.
+*/
+class DramMemory : public MemoryBackend {
+public:
+    DramMemory(const DramConfig& cfg);
+
+    double read(u64 block_addr, double now, double& stall) override;
+    void prefetch(u64 block_addr, double now) override;
+    double write(u64 block_addr, double now) override;
+
+private:
+    struct Bank {
+        u64 open_row = 0;
+        bool open = false;
+        double ready = 0; // Time the bank can start the next access
+    };
+
+    struct MSHR {
+        u64 block = 0;
+        double done = 0;
+    };
+
+    DramConfig cfg;
+    std::vector<Bank> banks;
+    std::vector<MSHR> mshrs;
+
+    // Service one access starting no earlier than `now`; returns completion time
+    double access(u64 block_addr, double now);
+};
+
+// Parse "fixed[:latency=L]" or "dram[:banks=N,row=R,page=open|closed,
+// tcas=..,trcd=..,trp=..,burst=..,ctrl=..,mshrs=M]" for 2^B-byte blocks (caller owns)
+MemoryBackend* make_memory(const std::string& spec, u64 B);
+
+#endif
@@ -0,0 +1,123 @@
+#include <algorithm>
+
+#include "multisim.hpp"
+
+MultiSim::MultiSim(const std::vector<CacheSize>& sizes) :
+            all_stats(sizes.size()), enabled(sizes.size(), true) {
+    // Stats live in a vector that is never resized, so the pointers hold
+    for (size_t i = 0; i < sizes.size(); i++)
+        caches.push_back(new Cache(sizes[i], find_cache_type(sizes[i]), &all_stats[i]));
+}
+
+MultiSim::~MultiSim() {
+    stop_workers();
+
+    for (auto c: caches)
+        delete c;
+}
+
+void MultiSim::run_share(const Access* records, const u64* addrs, size_t n, size_t first, size_t stride) {
+    for (size_t i = 0; i < n; i += ACCESS_BATCH) {
+        size_t len = std::min(ACCESS_BATCH, n - i);
+
+        for (size_t c = first; c < caches.size(); c += stride) {
+            if (enabled[c])
+                caches[c]->access_batch(records + i, len, addrs + i);
+        }
+    }
+}
+
+void MultiSim::worker(size_t share, u64 seen) {
+    while (true) {
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [&]() { return stopping || generation != seen; });
+
+        if (stopping)
+            return;
+
+        seen = generation;
+        guard.unlock();
+
+        run_share(job_records, addrs.data(), job_n, share, workers.size() + 1);
+
+        guard.lock();
+
+        if (--pending == 0)
+            finished.notify_one();
+    }
+}
+
+void MultiSim::stop_workers() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+
+    wake.notify_all();
+
+    for (auto& t: workers)
+        t.join();
+
+    workers.clear();
+    stopping = false;
+}
+
+void MultiSim::run(const std::vector<Access>& trace, size_t begin, size_t end, int threads) {
+    const Access* records = trace.data() + begin;
+    size_t n = end - begin;
+
+    threads = std::max(1, std::min(threads, static_cast<int>(caches.size())));
+
+    // Contiguous addresses, shared by every cache
+    addrs.resize(n);
+
+    for (size_t i = 0; i < n; i++)
+        addrs[i] = records[i].addr;
+
+    if (threads == 1) {
+        run_share(records, addrs.data(), n, 0, 1);
+        return;
+    }
+
+    // Workers are started once and kept (cacheopt calls run() per bound check)
+    if (workers.size() != static_cast<size_t>(threads - 1)) {
+        stop_workers();
+
+        for (int t = 1; t < threads; t++)
+            workers.emplace_back(&MultiSim::worker, this, t, generation);
+    }
+
+    // Caches never share state, so threads only share the read-only trace
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        job_records = records;
+        job_n = n;
+        pending = workers.size();
+        generation++;
+    }
+
+    wake.notify_all();
+    run_share(records, addrs.data(), n, 0, threads);
+
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [&]() { return pending == 0; });
+}
+
+void MultiSim::run(AccessSource* source) {
+    std::vector<Access> batch(ACCESS_BATCH);
+    size_t n;
+
+    addrs.resize(batch.size());
+
+    while ((n = source->next_batch(batch.data(), batch.size())) > 0) {
+        for (size_t i = 0; i < n; i++)
+            addrs[i] = batch[i].addr;
+
+        run_share(batch.data(), addrs.data(), n, 0, 1);
+    }
+}
+
+void MultiSim::compute_stats() {
+    for (auto c: caches)
+        c->compute_stats();
+}
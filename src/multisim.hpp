@@ -0,0 +1,69 @@
+#ifndef MULTISIM_H
+#define MULTISIM_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "cache.hpp"
+#include "trace.hpp"
+
+/**
+    Advances several caches in lockstep over one decoded access stream.
+
+    Each batch of ACCESS_BATCH records is decoded once and then consumed by
+    every cache while it is still hot in the host L1, instead of each
+    configuration walking (or decoding) the whole trace on its own. The
+    batch's addresses are also gathered once into a contiguous array, from
+    which each cache splits its tags and indices with vector instructions.
+    Caches can be split across threads; every thread reads the same
+    batches. The threads persist across run() calls.
+*/
+class MultiSim {
+public:
+    MultiSim(const std::vector<CacheSize>& sizes);
+    ~MultiSim();
+
+    size_t size() const { return caches.size(); }
+
+    Cache& cache(size_t i) { return *caches[i]; }
+    cache_stats_t& stats(size_t i) { return all_stats[i]; }
+
+    // Inactive caches are skipped by run() (e.g. once pruned)
+    bool active(size_t i) const { return enabled[i]; }
+    void deactivate(size_t i) { enabled[i] = false; }
+
+    // Advance every active cache over records [begin, end) of `trace`
+    // Caches are split over `threads` threads
+    void run(const std::vector<Access>& trace, size_t begin, size_t end, int threads = 1);
+
+    // Consume all of `source`, decoding each batch once
+    void run(AccessSource* source);
+
+    void compute_stats();
+
+private:
+    std::vector<cache_stats_t> all_stats;
+    std::vector<Cache*> caches;
+    std::vector<char> enabled;
+    std::vector<u64> addrs;        // Addresses of the records being run
+
+    // One thread's share: caches first, first + stride, ...
+    void run_share(const Access* records, const u64* addrs, size_t n, size_t first, size_t stride);
+
+    // Worker pool: run() takes share 0, worker t share t + 1
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable wake, finished;
+    u64 generation = 0;            // Bumped for every job
+    size_t pending = 0;            // Workers still on the current job
+    bool stopping = false;
+    const Access* job_records = nullptr;
+    size_t job_n = 0;
+
+    void worker(size_t share, u64 seen);  // `seen`: last job before it started
+    void stop_workers();
+};
+
+#endif
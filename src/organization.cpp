@@ -0,0 +1,404 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "organization.hpp"
+#include "util.hpp" // exit_on_error
+
+// Bits to tell `n` things apart
+static u64 bits_for(u64 n) {
+    u64 b = 0;
+
+    while ((static_cast<u64>(1) << b) < n)
+        b++;
+
+    return b;
+}
+
+OrgConfig parse_organization(const std::string& spec) {
+    SpecOptions opts;
+    std::string kind = parse_spec(spec, opts);
+    OrgConfig cfg;
+
+    if (kind == "dsc")
+        cfg.kind = ORG_SECTORED;
+    else if (kind == "compressed")
+        cfg.kind = ORG_COMPRESSED;
+    else
+        exit_on_error("Unknown cache organization: " + kind);
+
+    for (auto& kv: opts) {
+        const std::string& key = kv.first;
+        const std::string& val = kv.second;
+
+        if (key == "tags") {
+            cfg.tags = parse_size(val, 1);
+        } else if (key == "mix" && cfg.kind == ORG_COMPRESSED) {
+            // Shares of blocks per size, A+B+C+D
+            cfg.mix.clear();
+            size_t pos = 0;
+
+            while (pos <= val.size()) {
+                size_t plus = val.find('+', pos);
+                if (plus == std::string::npos)
+                    plus = val.size();
+
+                cfg.mix.push_back(atof(val.substr(pos, plus - pos).c_str()));
+                pos = plus + 1;
+            }
+        } else if (key == "lat" && cfg.kind == ORG_COMPRESSED) {
+            cfg.latency = atof(val.c_str());
+        } else if (key == "seed" && cfg.kind == ORG_COMPRESSED) {
+            cfg.seed = parse_size(val, 1);
+        } else {
+            exit_on_error("Unknown organization option: " + key + "=" + val);
+        }
+    }
+
+    if (cfg.tags == 0)
+        exit_on_error("Need at least one tag per frame.");
+
+    double total = 0;
+
+    for (double share: cfg.mix) {
+        if (share < 0)
+            exit_on_error("Compressed size shares cannot be negative.");
+        total += share;
+    }
+
+    if (cfg.mix.size() != 4 || total <= 0)
+        exit_on_error("mix needs four shares (1/4, 1/2, 3/4 and whole blocks).");
+
+    return cfg;
+}
+
+OrganizedCache::OrganizedCache(CacheSize size, u64 tags, cache_stats_t* stats) :
+            size(size), stats(stats) {
+    if (size.S > size.C - size.B)
+        exit_on_error("S must be <= C-B!");
+    if (size.K > size.B - 1)
+        exit_on_error("K must be <= B-1!");
+    if (size.V > 0)
+        exit_on_error("Sectored and compressed caches have no victim cache (use -V 0).");
+
+    sets = static_cast<u64>(1) << (size.C - size.B - size.S);
+    frames = static_cast<u64>(1) << size.S;
+    sectors = static_cast<u64>(1) << (size.B - size.K);
+    this->tags = frames * tags;
+
+    tag_store.resize(sets * this->tags);
+
+    stats->hit_time = cache_hit_time(size);
+    stats->miss_penalty = 100;
+}
+
+long OrganizedCache::find_tag(u64 set, u64 block) const {
+    const Tag* t = &tag_store[set * tags];
+
+    for (u64 i = 0; i < tags; i++) {
+        if (t[i].valid && t[i].block == block)
+            return i;
+    }
+
+    return -1;
+}
+
+u64 OrganizedCache::tag_bits() const {
+    return ADDR_BITS - (size.C - size.B - size.S) - size.B;
+}
+
+void OrganizedCache::access(const Access& a) {
+    if (a.mode == REPEAT) {
+        // Guaranteed hits on the last block: it is already MRU
+        u64 reads = repeat_reads(a), writes = repeat_writes(a);
+
+        stats->accesses += reads + writes;
+        stats->reads += reads;
+        stats->writes += writes;
+        resident_sum += static_cast<double>(resident) * (reads + writes);
+
+        if (writes > 0) {
+            u64 block = last_addr >> size.B;
+            tag_store[set_of(block) * tags + find_tag(set_of(block), block)].dirty = true;
+        }
+
+        return;
+    }
+
+    u64 offset_mask = (static_cast<u64>(1) << size.B) - 1;
+    u64 end = a.addr + std::max<u64>(a.size, 1);
+
+    if (a.size > 1 && (a.addr & offset_mask) + a.size > offset_mask + 1)
+        stats->split_accesses++;
+
+    // One access per block touched
+    for (u64 addr = a.addr; addr < end; addr = (addr | offset_mask) + 1) {
+        stats->accesses++;
+
+        if (a.mode == WRITE)
+            stats->writes++;
+        else
+            stats->reads++;
+
+        last_addr = addr;
+        reference(addr, a.mode == WRITE);
+        resident_sum += resident;
+    }
+}
+
+void OrganizedCache::compute_stats() {
+    stats->misses = stats->read_misses + stats->write_misses;
+    stats->miss_rate = static_cast<double>(stats->misses + stats->subblock_misses) / stats->accesses;
+    stats->avg_access_time = stats->hit_time + stats->miss_rate * stats->miss_penalty;
+
+    // Against a conventional cache of the same geometry: one tag, valid
+    // bits per sub-block and a dirty bit per frame
+    u64 conventional = sets * frames * (tag_bits() + sectors + 1);
+
+    stats->effective_capacity = resident_sum / stats->accesses;
+    stats->capacity_ratio = stats->effective_capacity / (static_cast<u64>(1) << size.C);
+    stats->metadata_bits = metadata_bits();
+    stats->metadata_ratio = static_cast<double>(stats->metadata_bits) / conventional;
+}
+
+SectoredCache::SectoredCache(CacheSize size, const OrgConfig& config, cache_stats_t* stats) :
+            OrganizedCache(size, config.tags, stats),
+            where(sets * tags * sectors, 0), owner(sets * sectors * frames, 0) {
+}
+
+void SectoredCache::drop_tag(u64 set, u64 t) {
+    Tag& tag = tag_store[set * tags + t];
+    u64* w = &where[(set * tags + t) * sectors];
+    u64 sector_bytes = static_cast<u64>(1) << size.K;
+
+    // One writeback per dirty block, as in Cache, however many of its
+    // sectors it already lost
+    if (tag.dirty) {
+        stats->write_backs++;
+        stats->bytes_transferred += tag.held * sector_bytes;
+    }
+
+    for (u64 p = 0; p < sectors; p++) {
+        if (w[p] != 0) {
+            owner[(set * sectors + p) * frames + w[p] - 1] = 0;
+            w[p] = 0;
+        }
+    }
+
+    resident -= tag.held * sector_bytes;
+    tag = Tag();
+}
+
+void SectoredCache::fill_sector(u64 set, u64 t, u64 p) {
+    u64* slots = &owner[(set * sectors + p) * frames];
+    u64 sector_bytes = static_cast<u64>(1) << size.K;
+    u64 f = 0;
+
+    // An empty slot, or else the one whose block was least recently used
+    for (u64 i = 0; i < frames; i++) {
+        if (slots[i] == 0) {
+            f = i;
+            break;
+        }
+
+        if (tag_store[set * tags + slots[i] - 1].stamp < tag_store[set * tags + slots[f] - 1].stamp)
+            f = i;
+    }
+
+    if (slots[f] != 0) {
+        u64 old = slots[f] - 1;
+        Tag& victim = tag_store[set * tags + old];
+
+        // The other block loses one sector; its writeback is counted
+        // once, when the last sector goes
+        if (victim.dirty)
+            stats->bytes_transferred += sector_bytes;
+
+        where[(set * tags + old) * sectors + p] = 0;
+        victim.held--;
+        resident -= sector_bytes;
+
+        if (victim.held == 0) {
+            if (victim.dirty)
+                stats->write_backs++;
+
+            victim = Tag();
+        }
+    }
+
+    slots[f] = t + 1;
+    where[(set * tags + t) * sectors + p] = f + 1;
+    tag_store[set * tags + t].held++;
+    resident += sector_bytes;
+    stats->bytes_transferred += sector_bytes;
+}
+
+void SectoredCache::reference(u64 addr, bool write) {
+    u64 block = addr >> size.B;
+    u64 set = set_of(block);
+    u64 first = (addr & ((static_cast<u64>(1) << size.B) - 1)) >> size.K;
+    long t = find_tag(set, block);
+
+    if (t >= 0 && where[(set * tags + t) * sectors + first] != 0) {
+        // Hit
+        Tag& tag = tag_store[set * tags + t];
+        tag.stamp = ++clock;
+        tag.dirty |= write;
+        return;
+    }
+
+    if (t >= 0) {
+        stats->subblock_misses++;
+    } else {
+        if (write)
+            stats->write_misses++;
+        else
+            stats->read_misses++;
+
+        // A free tag, or else the least recently used block's
+        Tag* set_tags = &tag_store[set * tags];
+        t = 0;
+
+        for (u64 i = 0; i < tags; i++) {
+            if (!set_tags[i].valid) {
+                t = i;
+                break;
+            }
+
+            if (set_tags[i].stamp < set_tags[t].stamp)
+                t = i;
+        }
+
+        if (set_tags[t].valid)
+            drop_tag(set, t);
+
+        set_tags[t].valid = true;
+        set_tags[t].block = block;
+    }
+
+    // Stamp first: the block's own sectors are never the LRU candidates
+    Tag& tag = tag_store[set * tags + t];
+    tag.stamp = ++clock;
+
+    for (u64 p = first; p < sectors; p++) {
+        if (where[(set * tags + t) * sectors + p] == 0)
+            fill_sector(set, t, p);
+    }
+
+    tag.dirty |= write;
+}
+
+u64 SectoredCache::metadata_bits() const {
+    // Tags with valid and dirty bits; a valid bit and tag pointer per sector slot
+    u64 per_tag = tag_bits() + 2;
+    u64 per_slot = 1 + bits_for(tags);
+
+    return sets * (tags * per_tag + frames * sectors * per_slot);
+}
+
+CompressedCache::CompressedCache(CacheSize size, const OrgConfig& config, cache_stats_t* stats) :
+            OrganizedCache(size, config.tags, stats), config(config), used(sets, 0) {
+    // Every hit decompresses
+    stats->hit_time += config.latency;
+}
+
+u64 CompressedCache::segments(u64 block) const {
+    // splitmix64 of the block address: a fixed, well-spread draw per block
+    u64 z = block + config.seed * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+
+    double total = 0;
+
+    for (double share: config.mix)
+        total += share;
+
+    double u = (z >> 11) * (1.0 / 9007199254740992.0) * total;
+    int quarters = 4;
+
+    for (int q = 0; q < 4; q++) {
+        if (u < config.mix[q]) {
+            quarters = q + 1;
+            break;
+        }
+
+        u -= config.mix[q];
+    }
+
+    return std::max<u64>(1, (sectors * quarters + 3) / 4);
+}
+
+void CompressedCache::evict(u64 set, u64 t) {
+    Tag& tag = tag_store[set * tags + t];
+
+    if (tag.dirty) {
+        stats->write_backs++;
+        stats->bytes_transferred += static_cast<u64>(1) << size.B;
+    }
+
+    used[set] -= tag.held;
+    resident -= static_cast<u64>(1) << size.B;
+    tag = Tag();
+}
+
+void CompressedCache::reference(u64 addr, bool write) {
+    u64 block = addr >> size.B;
+    u64 set = set_of(block);
+    long t = find_tag(set, block);
+    Tag* set_tags = &tag_store[set * tags];
+
+    if (t < 0) {
+        if (write)
+            stats->write_misses++;
+        else
+            stats->read_misses++;
+
+        u64 need = segments(block);
+        u64 capacity = frames * sectors;
+
+        // Evict LRU blocks until a tag and enough segments are free
+        while (true) {
+            long free_tag = -1, lru = -1;
+
+            for (u64 i = 0; i < tags; i++) {
+                if (!set_tags[i].valid) {
+                    if (free_tag < 0)
+                        free_tag = i;
+                } else if (lru < 0 || set_tags[i].stamp < set_tags[lru].stamp) {
+                    lru = i;
+                }
+            }
+
+            if (free_tag >= 0 && used[set] + need <= capacity) {
+                t = free_tag;
+                break;
+            }
+
+            evict(set, lru);
+        }
+
+        set_tags[t].valid = true;
+        set_tags[t].block = block;
+        set_tags[t].held = need;
+        used[set] += need;
+        resident += static_cast<u64>(1) << size.B;
+        stats->bytes_transferred += static_cast<u64>(1) << size.B;
+    }
+
+    set_tags[t].stamp = ++clock;
+    set_tags[t].dirty |= write;
+}
+
+u64 CompressedCache::metadata_bits() const {
+    // Tags with valid and dirty bits, compressed size and first segment
+    u64 per_tag = tag_bits() + 2 + bits_for(sectors + 1) + bits_for(frames * sectors);
+
+    return sets * tags * per_tag;
+}
+
+OrganizedCache* make_organization(CacheSize size, const OrgConfig& config, cache_stats_t* stats) {
+    if (config.kind == ORG_COMPRESSED)
+        return new CompressedCache(size, config, stats);
+
+    return new SectoredCache(size, config, stats);
+}
@@ -0,0 +1,137 @@
+#ifndef ORGANIZATION_H
+#define ORGANIZATION_H
+
+#include <string>
+#include <vector>
+
+#include "cache.hpp"
+#include "cachesim.hpp"
+
+enum OrgKind {
+    ORG_SECTORED,    // Decoupled sectored (Seznec, ISCA 1994)
+    ORG_COMPRESSED   // Compressed blocks, more tags than frames
+};
+
+struct OrgConfig {
+    OrgKind kind = ORG_SECTORED;
+    u64 tags = 2;                 // Tags per data frame
+    std::vector<double> mix = {0.2, 0.3, 0.2, 0.3}; // ORG_COMPRESSED: share of blocks
+                                  // compressing to 1/4, 1/2, 3/4 and all of a block
+    double latency = 1;           // ORG_COMPRESSED: decompression cycles added to hits
+    u64 seed = 1;                 // ORG_COMPRESSED: picks each block's size
+};
+
+// Parse "dsc[:tags=R]" or "compressed[:tags=R,mix=A+B+C+D,lat=L,seed=S]"
+OrgConfig parse_organization(const std::string& spec);
+
+/**
+    A write-back cache whose sets hold more tags than data frames.
+
+    Same geometry as a Cache (C, B, S; K is the sector or compression
+    segment size) and the same statistics, plus the effective capacity
+    (uncompressed bytes of valid data held, averaged over the accesses)
+    and the metadata bits the organization needs. LRU only; no victim
+    cache, prefetcher, write buffer or memory model.
+*/
+class OrganizedCache {
+public:
+    OrganizedCache(CacheSize size, u64 tags, cache_stats_t* stats);
+    virtual ~OrganizedCache() {}
+
+    // Any trace record: splits spanning records, replays REPEAT records
+    // (exact only where a hit implies the rest of the block is held)
+    void access(const Access& a);
+
+    void compute_stats();
+
+protected:
+    CacheSize size;
+    cache_stats_t* stats;
+
+    u64 sets, frames, sectors;    // Per set: frames; per block: sectors
+    u64 tags;                     // Tags per set
+    u64 clock = 0;                // LRU time stamps
+    u64 resident = 0;             // Bytes of valid data held (uncompressed)
+
+    struct Tag {
+        u64 block = 0;            // Block address
+        bool valid = false, dirty = false;
+        u64 stamp = 0;            // Last use
+        u64 held = 0;             // Sectors held / segments used
+    };
+
+    std::vector<Tag> tag_store;   // [set * tags + t]
+
+    inline u64 set_of(u64 block) const { return block & (sets - 1); }
+
+    // Tag index of `block` in its set, or -1
+    long find_tag(u64 set, u64 block) const;
+
+    // One access to the block holding `addr`
+    virtual void reference(u64 addr, bool write) = 0;
+
+    // Metadata storage bits of the whole cache
+    virtual u64 metadata_bits() const = 0;
+
+    // Tag bits of a block address in a cache with `sets` sets
+    u64 tag_bits() const;
+
+private:
+    u64 last_addr = 0;            // Target of REPEAT records
+    double resident_sum = 0;
+};
+
+/**
+    Decoupled sectored cache: every set has `tags` address tags per data
+    frame, and each sector slot of a frame carries a pointer to the tag it
+    belongs to. Sector p of a block can sit in slot p of any frame of its
+    set, so blocks that are only partly used share frames. Fills follow
+    the sub-block rule of Cache (from the missing sector to the end of the
+    block); a sector is replaced by the one whose block was least recently
+    used, and a block losing its last sector frees its tag. Dirty blocks
+    write back each sector they lose, counted as one writeback per block.
+*/
+class SectoredCache : public OrganizedCache {
+public:
+    SectoredCache(CacheSize size, const OrgConfig& config, cache_stats_t* stats);
+
+protected:
+    void reference(u64 addr, bool write) override;
+    u64 metadata_bits() const override;
+
+private:
+    std::vector<u64> where;   // [(set * tags + t) * sectors + p] -> frame + 1 (0 = absent)
+    std::vector<u64> owner;   // [(set * sectors + p) * frames + f] -> tag + 1 (0 = empty)
+
+    void drop_tag(u64 set, u64 t);
+    void fill_sector(u64 set, u64 t, u64 p);
+};
+
+/**
+    Compressed cache: each set's data array is a pool of segments (2^K
+    bytes, frames * 2^(B-K) of them) shared by `tags` tags per frame. A
+    block takes the segments its compressed size needs; a fill evicts LRU
+    blocks until both a tag and enough segments are free. Block sizes are
+    drawn from the configured distribution by a hash of the block address,
+    so a block always compresses the same way. Fills and writebacks move
+    whole uncompressed blocks.
+*/
+class CompressedCache : public OrganizedCache {
+public:
+    CompressedCache(CacheSize size, const OrgConfig& config, cache_stats_t* stats);
+
+protected:
+    void reference(u64 addr, bool write) override;
+    u64 metadata_bits() const override;
+
+private:
+    OrgConfig config;
+    std::vector<u64> used;      // Segments used per set
+
+    u64 segments(u64 block) const;
+    void evict(u64 set, u64 t);
+};
+
+OrganizedCache* make_organization(CacheSize size, const OrgConfig& config, cache_stats_t* stats);
+
+#endif
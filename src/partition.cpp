@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "partition.hpp"
+#include "util.hpp" // exit_on_error
+
+PartitionConfig parse_partition(const std::string& spec) {
+    SpecOptions opts;
+    std::string kind = parse_spec(spec, opts);
+    PartitionConfig cfg;
+
+    if (kind == "none") {
+        cfg.policy = PART_NONE;
+    } else if (kind == "static") {
+        cfg.policy = PART_STATIC;
+    } else if (kind == "ucp") {
+        cfg.policy = PART_UCP;
+    } else {
+        exit_on_error("Unknown partition policy: " + kind);
+    }
+
+    for (auto& kv: opts) {
+        const std::string& key = kv.first;
+        const std::string& val = kv.second;
+
+        if (key == "ways" && cfg.policy == PART_STATIC) {
+            size_t pos = 0;
+
+            // Ways per program separated by '+'
+            while (pos <= val.size()) {
+                size_t plus = val.find('+', pos);
+                if (plus == std::string::npos)
+                    plus = val.size();
+
+                int w = atoi(val.substr(pos, plus - pos).c_str());
+                if (w <= 0)
+                    exit_on_error("Every program needs at least one way.");
+
+                cfg.ways.push_back(w);
+                pos = plus + 1;
+            }
+        } else if (key == "epoch" && cfg.policy == PART_UCP) {
+            cfg.epoch = parse_size(val, 1000);
+        } else if (key == "sample" && cfg.policy == PART_UCP) {
+            cfg.sample = parse_size(val, 1);
+        } else {
+            exit_on_error("Unknown partition option: " + key + "=" + val);
+        }
+    }
+
+    if (cfg.policy == PART_STATIC && cfg.ways.empty())
+        exit_on_error("Static partitioning needs ways=A+B+...");
+    if (cfg.policy == PART_UCP && (cfg.epoch == 0 || cfg.sample == 0))
+        exit_on_error("UCP epoch and sample must be positive.");
+
+    return cfg;
+}
+
+UtilityMonitor::UtilityMonitor(int programs, u64 sets, int ways, u64 B, u64 sample) :
+            programs(programs), ways(ways), sets(sets), B(B) {
+    // Every stride-th set is sampled
+    stride = std::max<u64>(sets / std::min(sample, sets), 1);
+
+    u64 sampled = (sets + stride - 1) / stride;
+
+    shadow.assign(programs, std::vector<std::vector<u64>>(sampled));
+    hits.assign(programs, std::vector<u64>(ways, 0));
+}
+
+void UtilityMonitor::access(int p, u64 addr) {
+    u64 block = addr >> B;
+    u64 set = block & (sets - 1);
+
+    if (set % stride != 0)
+        return;
+
+    auto& stack = shadow[p][set / stride];
+    auto it = std::find(stack.begin(), stack.end(), block);
+
+    if (it != stack.end()) {
+        hits[p][it - stack.begin()]++;
+        stack.erase(it);
+    } else if (stack.size() == static_cast<size_t>(ways)) {
+        stack.pop_back();
+    }
+
+    stack.insert(stack.begin(), block);
+}
+
+u64 UtilityMonitor::utility(int p, int n) const {
+    u64 sum = 0;
+
+    for (int i = 0; i < n; i++)
+        sum += hits[p][i];
+
+    return sum;
+}
+
+void UtilityMonitor::allocate(std::vector<int>& quotas) {
+    quotas.assign(programs, 1);
+
+    int left = ways - programs;
+
+    // Lookahead: give the next ways to the program with the best hits per
+    // way over any number of extra ways (handles non-convex utility)
+    while (left > 0) {
+        int best = 0, best_n = 1;
+        double best_mu = -1;
+
+        for (int p = 0; p < programs; p++) {
+            u64 base = utility(p, quotas[p]);
+
+            for (int n = 1; n <= left; n++) {
+                double mu = static_cast<double>(utility(p, quotas[p] + n) - base) / n;
+
+                if (mu > best_mu) {
+                    best = p;
+                    best_n = n;
+                    best_mu = mu;
+                }
+            }
+        }
+
+        quotas[best] += best_n;
+        left -= best_n;
+    }
+
+    for (auto& h: hits)
+        for (auto& count: h)
+            count /= 2;
+}
+
+SharedSim::SharedSim(Cache& cache, const PartitionConfig& part, u64 quantum) :
+            cache(cache), part(part), quantum(quantum) {
+    if (quantum == 0)
+        exit_on_error("Quantum must be at least one access.");
+}
+
+SharedSim::~SharedSim() {
+    delete monitor;
+}
+
+void SharedSim::run(const std::vector<std::vector<Access>>& traces, std::vector<cache_stats_t>& stats) {
+    int programs = traces.size();
+    int ways = cache.ways();
+
+    std::vector<cache_stats_t*> per_program;
+
+    for (auto& cs: stats)
+        per_program.push_back(&cs);
+
+    cache.set_programs(per_program);
+
+    if (part.policy != PART_NONE && programs > ways)
+        exit_on_error("Partitioning needs at least one way per program.");
+
+    if (part.policy == PART_STATIC) {
+        if (part.ways.size() != traces.size())
+            exit_on_error("Need one way count per program.");
+
+        int total = 0;
+        for (int w: part.ways)
+            total += w;
+
+        if (total != ways)
+            exit_on_error("Static partition must cover exactly " + std::to_string(ways) + " ways.");
+
+        quotas = part.ways;
+    } else if (part.policy == PART_UCP) {
+        monitor = new UtilityMonitor(programs, cache.sets(), ways, cache.block_bits(), part.sample);
+
+        // Even split until the first epoch has been measured
+        quotas.assign(programs, ways / programs);
+        for (int p = 0; p < ways % programs; p++)
+            quotas[p]++;
+    } else {
+        quotas.assign(programs, ways);
+    }
+
+    if (part.policy != PART_NONE)
+        cache.set_quotas(quotas);
+
+    std::vector<size_t> pos(programs, 0);
+    int running = programs;
+    u64 next_epoch = part.epoch;
+    u64 total = 0;
+
+    while (running > 0) {
+        running = 0;
+
+        for (int p = 0; p < programs; p++) {
+            const std::vector<Access>& trace = traces[p];
+            size_t end = std::min(pos[p] + quantum, trace.size());
+
+            if (pos[p] == end)
+                continue;
+
+            cache.set_program(p);
+
+            for (size_t i = pos[p]; i < end; i++) {
+                Access a = trace[i];
+                a.addr = program_addr(p, a.addr);
+
+                cache.access(a);
+
+                if (monitor != nullptr) {
+                    monitor->access(p, a.addr);
+
+                    if (++total == next_epoch) {
+                        monitor->allocate(quotas);
+                        cache.set_quotas(quotas);
+                        next_epoch += part.epoch;
+                    }
+                }
+            }
+
+            pos[p] = end;
+
+            if (end < trace.size())
+                running++;
+        }
+    }
+
+    for (int p = 0; p < programs; p++) {
+        cache.set_program(p);
+        cache.compute_stats();
+    }
+}
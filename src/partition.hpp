@@ -0,0 +1,96 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <string>
+#include <vector>
+
+#include "cache.hpp"
+#include "cachesim.hpp"
+
+enum PartitionPolicy {
+    PART_NONE,    // Shared LRU
+    PART_STATIC,  // Fixed ways per program
+    PART_UCP      // Utility-based (Qureshi & Patt, MICRO 2006)
+};
+
+struct PartitionConfig {
+    PartitionPolicy policy = PART_NONE;
+    std::vector<int> ways;  // PART_STATIC: ways per program
+    u64 epoch = 1000000;    // PART_UCP: accesses between reallocations
+    u64 sample = 32;        // PART_UCP: sets with shadow tags
+};
+
+// Parse "none", "static:ways=A+B+..." or "ucp[:epoch=N,sample=S]"
+PartitionConfig parse_partition(const std::string& spec);
+
+/**
+    Utility monitors for UCP: per-program shadow tag directories.
+
+    Each program gets a private LRU tag stack for every sampled set, as if
+    it had the whole cache to itself, and counts hits per stack position.
+    Hits at position i would be hits with i + 1 or more ways, so the
+    counters give each program's hits as a function of its allocation.
+*/
+class UtilityMonitor {
+public:
+    UtilityMonitor(int programs, u64 sets, int ways, u64 B, u64 sample);
+
+    // Record an access by program `p`
+    void access(int p, u64 addr);
+
+    // Split the ways by greatest marginal utility (at least one each),
+    // then halve the counters so older epochs fade out
+    void allocate(std::vector<int>& quotas);
+
+private:
+    int programs, ways;
+    u64 sets, B, stride;
+
+    // [program][sampled set] -> tags, MRU first
+    std::vector<std::vector<std::vector<u64>>> shadow;
+
+    // [program][stack position] -> hits
+    std::vector<std::vector<u64>> hits;
+
+    // Hits of program `p` with `n` ways
+    u64 utility(int p, int n) const;
+};
+
+/**
+    Interleaves several programs on one shared cache.
+
+    Programs take turns in quanta of `quantum` accesses; once a program's
+    trace ends the rest keep taking turns. Each program's addresses are
+    made private (distinct top byte) so programs never share blocks, and
+    its accesses are counted in its own stats.
+*/
+class SharedSim {
+public:
+    SharedSim(Cache& cache, const PartitionConfig& part, u64 quantum);
+    ~SharedSim();
+
+    // Run `traces[p]` for each program p, counting into `stats[p]`
+    void run(const std::vector<std::vector<Access>>& traces, std::vector<cache_stats_t>& stats);
+
+    // Ways each program ended up with (all ways each if unpartitioned)
+    const std::vector<int>& ways() const { return quotas; }
+
+private:
+    Cache& cache;
+    PartitionConfig part;
+    u64 quantum;
+    std::vector<int> quotas;
+    UtilityMonitor* monitor = nullptr;
+};
+
+// Program numbers go in the top byte; traces must leave it clear
+static const int PROGRAM_SHIFT = 56;
+static const int MAX_PROGRAMS = 256;
+
+// Address of program `p`'s `addr` in the shared address space (distinct
+// for every program as long as `addr` is below 2^PROGRAM_SHIFT)
+inline u64 program_addr(int p, u64 addr) {
+    return addr | (static_cast<u64>(p) << PROGRAM_SHIFT);
+}
+
+#endif
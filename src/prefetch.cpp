@@ -0,0 +1,156 @@
+#include <cstdlib>
+
+#include "prefetch.hpp"
+#include "util.hpp" // exit_on_error
+
+void Prefetcher::attach(u64 B, cache_stats_t* stats) {
+    this->B = B;
+    this->stats = stats;
+}
+
+void NextLinePrefetcher::observe(u64 addr, bool trigger, std::vector<u64>& out) {
+    if (!trigger)
+        return;
+
+    u64 block = block_of(addr);
+
+    for (int i = 1; i <= n; i++)
+        out.push_back(block + (static_cast<u64>(i) << B));
+}
+
+StridePrefetcher::StridePrefetcher(int entries, int degree, u64 region_bits) :
+            table(entries), degree(degree), region_bits(region_bits) {}
+
+void StridePrefetcher::observe(u64 addr, bool trigger, std::vector<u64>& out) {
+    u64 region = addr >> region_bits;
+    Entry& e = table[region % table.size()];
+
+    // New region: (re)allocate the entry
+    if (!e.valid || e.region != region) {
+        e.valid = true;
+        e.region = region;
+        e.last = addr;
+        e.stride = 0;
+        e.confidence = 0;
+        return;
+    }
+
+    int64_t stride = static_cast<int64_t>(addr - e.last);
+
+    if (stride == 0)
+        return;
+
+    if (stride == e.stride) {
+        if (e.confidence < 3)
+            e.confidence++;
+    } else {
+        if (e.confidence > 0)
+            e.confidence--;
+        else
+            e.stride = stride;
+    }
+
+    e.last = addr;
+
+    // Steady state: prefetch `degree` strides ahead (one request per block)
+    if (e.confidence >= 2) {
+        u64 prev = block_of(addr);
+
+        for (int i = 1; i <= degree; i++) {
+            u64 block = block_of(addr + e.stride * i);
+
+            if (block != prev)
+                out.push_back(block);
+
+            prev = block;
+        }
+    }
+}
+
+StreamBufferPrefetcher::StreamBufferPrefetcher(int buffers, int depth) :
+            streams(buffers), depth(depth) {}
+
+void StreamBufferPrefetcher::fetch(Stream& s) {
+    s.blocks.push_back(s.next);
+    s.next += static_cast<u64>(1) << B;
+
+    stats->prefetches++;
+    stats->prefetch_bytes += static_cast<u64>(1) << B;
+    stats->bytes_transferred += static_cast<u64>(1) << B;
+}
+
+bool StreamBufferPrefetcher::probe(u64 block_addr) {
+    clock++;
+
+    // Hit at the head of a stream: hand the block over, refill the tail
+    for (auto& s: streams) {
+        if (!s.blocks.empty() && s.blocks.front() == block_addr) {
+            s.blocks.pop_front();
+            s.last_use = clock;
+            fetch(s);
+            return true;
+        }
+    }
+
+    // Miss everywhere: restart the least recently used stream after this block
+    Stream* lru = &streams[0];
+
+    for (auto& s: streams)
+        if (s.last_use < lru->last_use)
+            lru = &s;
+
+    stats->prefetch_unused += lru->blocks.size();
+    lru->blocks.clear();
+    lru->next = block_addr + (static_cast<u64>(1) << B);
+    lru->last_use = clock;
+
+    for (int i = 0; i < depth; i++)
+        fetch(*lru);
+
+    return false;
+}
+
+Prefetcher* make_prefetcher(const std::string& spec, u64 B) {
+    SpecOptions opts;
+    std::string kind = parse_spec(spec, opts);
+
+    // Defaults
+    int n = 1, entries = 64, degree = 2, buffers = 4, depth = 4;
+    u64 region = 12;
+
+    for (auto& kv: opts) {
+        // Region is a log2 size, the rest are counts
+        if (kv.first == "region") {
+            region = parse_log2(kv.second, B, "region");
+            continue;
+        }
+
+        int v = static_cast<int>(parse_size(kv.second, 1024));
+
+        if (kv.first == "n")
+            n = v;
+        else if (kv.first == "entries")
+            entries = v;
+        else if (kv.first == "degree")
+            degree = v;
+        else if (kv.first == "buffers")
+            buffers = v;
+        else if (kv.first == "depth")
+            depth = v;
+        else
+            exit_on_error("Unknown prefetcher option: " + kv.first);
+    }
+
+    if (n <= 0 || entries <= 0 || degree <= 0 || buffers <= 0 || depth <= 0)
+        exit_on_error("Prefetcher options must be positive.");
+
+    if (kind == "next")
+        return new NextLinePrefetcher(n);
+    else if (kind == "stride")
+        return new StridePrefetcher(entries, degree, region);
+    else if (kind == "stream")
+        return new StreamBufferPrefetcher(buffers, depth);
+
+    exit_on_error("Unknown prefetcher: " + kind);
+    return nullptr;
+}
@@ -0,0 +1,94 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "cachesim.hpp"
+
+/**
+    Hardware prefetcher attached to a Cache.
+
+    Prefetchers see every demand access and either request blocks to be
+    filled into the cache (next-line, stride) or hold prefetched blocks in
+    their own buffers and serve them on a cache miss (stream buffers).
+    All addresses handed to the cache are block-aligned.
+*/
+class Prefetcher {
+public:
+    virtual ~Prefetcher() {}
+
+    // Called by Cache::set_prefetcher()
+    void attach(u64 B, cache_stats_t* stats);
+
+    // Observe a demand access. `trigger` is set on a demand miss or on the
+    // first hit to a prefetched block. Appends blocks to prefetch to `out`.
+    virtual void observe(u64 addr, bool trigger, std::vector<u64>& out) = 0;
+
+    // On a demand miss: true if the block is held by the prefetcher itself
+    // (and hands it to the cache). Blocks fetched here are charged to stats.
+    virtual bool probe(u64 block_addr) { return false; }
+
+protected:
+    u64 B = 0;
+    cache_stats_t* stats = nullptr;
+
+    inline u64 block_of(u64 addr) {
+        return addr & ~((static_cast<u64>(1) << B) - 1);
+    }
+};
+
+// Prefetch the next N blocks on a miss or a prefetched-block hit (tagged)
+class NextLinePrefetcher : public Prefetcher {
+public:
+    NextLinePrefetcher(int n) : n(n) {}
+    void observe(u64 addr, bool trigger, std::vector<u64>& out) override;
+private:
+    int n;
+};
+
+// Detects constant strides per memory region (e.g. 4 KB page)
+class StridePrefetcher : public Prefetcher {
+public:
+    StridePrefetcher(int entries, int degree, u64 region_bits);
+    void observe(u64 addr, bool trigger, std::vector<u64>& out) override;
+private:
+    struct Entry {
+        u64 region = 0;
+        u64 last = 0;
+        int64_t stride = 0;
+        int confidence = 0; // 2-bit saturating
+        bool valid = false;
+    };
+
+    std::vector<Entry> table;
+    int degree;
+    u64 region_bits;
+};
+
+// Jouppi-style stream buffers: FIFOs of sequential blocks beside the cache
+class StreamBufferPrefetcher : public Prefetcher {
+public:
+    StreamBufferPrefetcher(int buffers, int depth);
+    void observe(u64 addr, bool trigger, std::vector<u64>& out) override {}
+    bool probe(u64 block_addr) override;
+private:
+    struct Stream {
+        std::deque<u64> blocks;
+        u64 next = 0;     // Next block to fetch into the tail
+        u64 last_use = 0; // For LRU replacement of streams
+    };
+
+    std::vector<Stream> streams;
+    int depth;
+    u64 clock = 0;
+
+    void fetch(Stream& s);
+};
+
+// Parse "next[:n=N]", "stride[:entries=E,degree=D,region=R]" or
+// "stream[:buffers=N,depth=D]" for 2^B-byte blocks (caller owns)
+Prefetcher* make_prefetcher(const std::string& spec, u64 B);
+
+#endif
@@ -0,0 +1,172 @@
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+
+#include "profile.hpp"
+
+// C includes
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+static const char* PHASE_NAMES[NUM_PHASES] = {"parse", "simulate", "report"};
+
+#ifdef __linux__
+static const u64 COUNTER_CONFIGS[NUM_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static int open_counter(u64 config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;        // Writer and time-parallel threads too
+    attr.exclude_kernel = 1; // Allowed at the default paranoia level
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+Profiler::Profiler() {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+#ifdef __linux__
+        fds[c] = open_counter(COUNTER_CONFIGS[c]);
+
+        if (fds[c] < 0 && unavailable.empty())
+            unavailable = strerror(errno);
+#else
+        fds[c] = -1;
+        unavailable = "not Linux";
+#endif
+    }
+
+#ifdef __linux__
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (fds[c] >= 0)
+            ioctl(fds[c], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+Profiler::~Profiler() {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (fds[c] >= 0)
+            close(fds[c]);
+    }
+}
+
+void Profiler::read_counters(u64 values[NUM_COUNTERS]) const {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        // value, time enabled, time running
+        u64 v[3] = {};
+
+        if (fds[c] < 0 || read(fds[c], v, sizeof(v)) != sizeof(v) || v[2] == 0) {
+            values[c] = 0;
+            continue;
+        }
+
+        // Scale up if the PMU was shared with other events
+        values[c] = (v[2] < v[1]) ? static_cast<u64>(static_cast<double>(v[0]) * v[1] / v[2]) : v[0];
+    }
+}
+
+void Profiler::enter(ProfilePhase phase) {
+    switch_to(phase);
+}
+
+void Profiler::stop() {
+    switch_to(-1);
+}
+
+void Profiler::switch_to(int phase) {
+    if (current == phase)
+        return;
+
+    auto now = std::chrono::steady_clock::now();
+    u64 values[NUM_COUNTERS];
+
+    read_counters(values);
+
+    if (current >= 0)
+        seconds[current] += std::chrono::duration<double>(now - last_time).count();
+
+    // Multiplexed counts are estimates and can go down between reads:
+    // charge nothing then, and measure on from the highest estimate
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (values[c] <= last[c])
+            continue;
+
+        if (current >= 0)
+            counts[current][c] += values[c] - last[c];
+
+        last[c] = values[c];
+    }
+
+    current = phase;
+    last_time = now;
+}
+
+void Profiler::print(FILE* out, u64 accesses) const {
+    static const char* NAMES[NUM_COUNTERS] = {"cycles", "instructions", "LLC misses", "branch misses"};
+
+    fprintf(out, "\nHost Profile\n");
+    fprintf(out, "============\n");
+
+    int open = 0;
+
+    for (int c = 0; c < NUM_COUNTERS; c++)
+        open += (fds[c] >= 0);
+
+    if (open == 0)
+        fprintf(out, "Counters unavailable (%s): wall time only\n", unavailable.c_str());
+    else if (open < NUM_COUNTERS)
+        fprintf(out, "Some counters unavailable (%s)\n", unavailable.c_str());
+
+    fprintf(out, "%-9s %12s %16s %16s %14s %14s\n", "Phase", "Time (ms)", "Cycles", "Instructions",
+            "LLC misses", "Branch misses");
+
+    for (int p = 0; p < NUM_PHASES; p++) {
+        fprintf(out, "%-9s %12.3f", PHASE_NAMES[p], seconds[p] * 1000);
+
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            if (fds[c] >= 0)
+                fprintf(out, " %*" PRIu64, c < 2 ? 16 : 14, counts[p][c]);
+            else
+                fprintf(out, " %*s", c < 2 ? 16 : 14, "-");
+        }
+
+        fprintf(out, "\n");
+    }
+
+    if (accesses == 0)
+        return;
+
+    // Host cost of one simulated access (simulate phase only)
+    const u64* sim = counts[PHASE_SIMULATE];
+
+    fprintf(out, "Per simulated access: %.2f ns (parse %.2f ns)",
+            seconds[PHASE_SIMULATE] * 1e9 / accesses, seconds[PHASE_PARSE] * 1e9 / accesses);
+
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (fds[c] >= 0)
+            fprintf(out, ", %.3f %s", static_cast<double>(sim[c]) / accesses, NAMES[c]);
+    }
+
+    if (fds[COUNTER_CYCLES] >= 0 && fds[COUNTER_INSTRUCTIONS] >= 0 && sim[COUNTER_CYCLES] > 0)
+        fprintf(out, ", IPC %.2f", static_cast<double>(sim[COUNTER_INSTRUCTIONS]) / sim[COUNTER_CYCLES]);
+
+    fprintf(out, "\n");
+}
@@ -0,0 +1,70 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "cachesim.hpp"
+
+// Phases of a run the profiler attributes host cost to
+enum ProfilePhase {
+    PHASE_PARSE,     // Decoding the trace (or generating the workload)
+    PHASE_SIMULATE,  // Cache accesses
+    PHASE_REPORT,    // Printing the results
+    NUM_PHASES
+};
+
+// Hardware counters read around each phase
+enum ProfileCounter {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    NUM_COUNTERS
+};
+
+/**
+    Host-side profile of a simulation run.
+
+    The run calls enter() at every phase change; the time and counter
+    deltas since the previous call go to the phase being left. The
+    simulation loop switches between parse and simulate once per batch of
+    records, so per-access costs are batch averages and the counters are
+    read a few times per thousand accesses rather than around each one.
+
+    Counters come from perf_event_open (user space only, including threads
+    the run starts). Counters the host does not provide (no PMU, a
+    container, perf_event_paranoid) are left out and reported as missing;
+    wall time is always measured.
+*/
+class Profiler {
+public:
+    Profiler();
+    ~Profiler();
+
+    // Attribute everything since the last call to the current phase
+    void enter(ProfilePhase phase);
+
+    // End the current phase
+    void stop();
+
+    // Per-phase table and the simulate phase's cost per access
+    void print(FILE* out, u64 accesses) const;
+
+private:
+    int fds[NUM_COUNTERS];
+    std::string unavailable;  // Why counters are missing (empty = all open)
+
+    int current = -1;
+    std::chrono::steady_clock::time_point last_time;
+    u64 last[NUM_COUNTERS] = {};
+
+    double seconds[NUM_PHASES] = {};
+    u64 counts[NUM_PHASES][NUM_COUNTERS] = {};
+
+    void switch_to(int phase);  // -1 = none
+    void read_counters(u64 values[NUM_COUNTERS]) const;
+};
+
+#endif
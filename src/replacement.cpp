@@ -0,0 +1,94 @@
+#include "replacement.hpp"
+#include "util.hpp" // exit_on_error
+
+ShipPredictor::ShipPredictor(size_t entries, int bits) :
+            shct(entries, 1), max((1 << bits) - 1) {}
+
+bool ShipPredictor::fill(Block* block, uint32_t pc) {
+    block->pc = pc;
+
+    // Weakly reused until proven otherwise (counters start at 1)
+    return shct[signature(pc, shct.size())] == 0;
+}
+
+bool ShipPredictor::hit(Block* block, uint32_t pc) {
+    uint8_t& c = shct[signature(block->pc, shct.size())];
+
+    if (c < max)
+        c++;
+
+    return false;
+}
+
+void ShipPredictor::evict(Block* block) {
+    uint8_t& c = shct[signature(block->pc, shct.size())];
+
+    if (!block->reused && c > 0)
+        c--;
+}
+
+DeadBlockPredictor::DeadBlockPredictor(size_t entries, int bits, int threshold) :
+            table(entries, 0), max((1 << bits) - 1), threshold(threshold) {}
+
+bool DeadBlockPredictor::fill(Block* block, uint32_t pc) {
+    block->pc = pc;
+
+    return table[signature(pc, table.size())] >= threshold;
+}
+
+bool DeadBlockPredictor::hit(Block* block, uint32_t pc) {
+    // The previous access was not the last touch
+    uint8_t& prev = table[signature(block->pc, table.size())];
+
+    if (prev > 0)
+        prev--;
+
+    block->pc = pc;
+
+    return table[signature(pc, table.size())] >= threshold;
+}
+
+void DeadBlockPredictor::evict(Block* block) {
+    uint8_t& c = table[signature(block->pc, table.size())];
+
+    if (c < max)
+        c++;
+}
+
+ReplacementPredictor* make_replacement(const std::string& spec) {
+    SpecOptions opts;
+    std::string kind = parse_spec(spec, opts);
+
+    // Defaults
+    u64 entries = 16384;
+    int bits = (kind == "ship") ? 3 : 2;
+    int threshold = 2;
+
+    for (auto& kv: opts) {
+        u64 v = parse_size(kv.second, 1024);
+
+        if (kv.first == "entries")
+            entries = v;
+        else if (kv.first == "bits")
+            bits = static_cast<int>(v);
+        else if (kv.first == "threshold" && kind == "dbp")
+            threshold = static_cast<int>(v);
+        else
+            exit_on_error("Unknown replacement option: " + kv.first);
+    }
+
+    if (entries == 0 || (entries & (entries - 1)) != 0)
+        exit_on_error("Predictor entries must be a power of two.");
+    if (bits < 1 || bits > 8 || threshold < 1 || threshold > (1 << bits) - 1)
+        exit_on_error("Invalid predictor counter width or threshold.");
+
+    if (kind == "lru")
+        return nullptr;
+    else if (kind == "ship")
+        return new ShipPredictor(entries, bits);
+    else if (kind == "dbp")
+        return new DeadBlockPredictor(entries, bits, threshold);
+
+    exit_on_error("Unknown replacement policy: " + kind);
+    return nullptr;
+}
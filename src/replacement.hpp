@@ -0,0 +1,81 @@
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+#include <string>
+#include <vector>
+
+#include "block.hpp"
+#include "cachesim.hpp"
+
+/**
+    PC-based reuse predictor attached to a Cache.
+
+    The cache keeps its LRU stacks; a predictor only decides which blocks
+    are unlikely to be used again. Those are moved to the LRU position (at
+    fill or at a hit), so they are replaced before anything else in their
+    set. Every demand fill and hit passes the PC of the access.
+*/
+class ReplacementPredictor {
+public:
+    virtual ~ReplacementPredictor() {}
+
+    // Demand fill of `block` by `pc`; true = insert at LRU
+    virtual bool fill(Block* block, uint32_t pc) = 0;
+
+    // Demand hit on `block` by `pc`; true = move to LRU
+    virtual bool hit(Block* block, uint32_t pc) = 0;
+
+    // `block` is being evicted (still holds its state)
+    virtual void evict(Block* block) = 0;
+
+protected:
+    // Table index of a PC
+    static inline size_t signature(uint32_t pc, size_t entries) {
+        return (pc ^ (pc >> 13) ^ (pc >> 23)) & (entries - 1);
+    }
+};
+
+/**
+    SHiP (Wu et al., MICRO 2011) on top of LRU.
+
+    A table of saturating counters indexed by the signature of the PC that
+    filled a block learns whether that PC's blocks get reused: hits count
+    up, evictions without a hit count down. Fills by PCs whose counter is
+    zero go to the LRU position instead of MRU.
+*/
+class ShipPredictor : public ReplacementPredictor {
+public:
+    ShipPredictor(size_t entries, int bits);
+    bool fill(Block* block, uint32_t pc) override;
+    bool hit(Block* block, uint32_t pc) override;
+    void evict(Block* block) override;
+private:
+    std::vector<uint8_t> shct; // Signature history counter table
+    uint8_t max;
+};
+
+/**
+    Last-touch dead block predictor (in the spirit of Lai et al., ISCA 2001,
+    with a PC-only trace).
+
+    Counters indexed by the PC of a block's most recent access learn which
+    PCs tend to touch a block for the last time: an eviction counts up the
+    last toucher, a hit counts it down. A block whose latest access comes
+    from a PC at or above `threshold` is predicted dead and moved to LRU.
+*/
+class DeadBlockPredictor : public ReplacementPredictor {
+public:
+    DeadBlockPredictor(size_t entries, int bits, int threshold);
+    bool fill(Block* block, uint32_t pc) override;
+    bool hit(Block* block, uint32_t pc) override;
+    void evict(Block* block) override;
+private:
+    std::vector<uint8_t> table;
+    uint8_t max, threshold;
+};
+
+// Parse "lru", "ship[:entries=N,bits=B]" or "dbp[:entries=N,bits=B,threshold=T]"
+// Returns nullptr for plain LRU
+ReplacementPredictor* make_replacement(const std::string& spec);
+
+#endif
@@ -0,0 +1,148 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "results.hpp"
+#include "util.hpp" // exit_on_error
+
+// C includes
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Checksum of the sources (see Makefile); built by hand, only SIM_VERSION
+#ifndef SIM_MODEL_HASH
+#define SIM_MODEL_HASH "0"
+#endif
+
+static const u64 FNV_OFFSET = 0xcbf29ce484222325ULL;
+static const u64 FNV_PRIME = 0x100000001b3ULL;
+
+// Identifies a result file (and its layout)
+static const char RESULT_MAGIC[4] = {'C', 'S', 'R', '1'};
+
+static u64 fnv1a(const char* data, size_t n, u64 h = FNV_OFFSET) {
+    for (size_t i = 0; i < n; i++) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= FNV_PRIME;
+    }
+
+    return h;
+}
+
+static std::string to_hex(u64 v) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+    return buf;
+}
+
+std::string file_key(const std::string& path) {
+    std::ifstream ifs(path, std::ios::binary);
+
+    if (!ifs.good())
+        exit_on_error("File not found: " + path);
+
+    std::vector<char> buf(1 << 16);
+    u64 h = FNV_OFFSET;
+
+    while (ifs) {
+        ifs.read(buf.data(), buf.size());
+        h = fnv1a(buf.data(), ifs.gcount(), h);
+    }
+
+    return "file:" + to_hex(h);
+}
+
+std::string config_key(const CacheSize& size, const std::string& write,
+                       const std::string& prefetcher, const std::string& memory) {
+    std::ostringstream oss;
+
+    oss << "C=" << size.C << ",B=" << size.B << ",S=" << size.S
+        << ",K=" << size.K << ",V=" << size.V
+        << ";w=" << (write.empty() ? "wb" : write)
+        << ";p=" << prefetcher << ";M=" << memory;
+
+    return oss.str();
+}
+
+ResultStore::ResultStore(const std::string& dir) : dir(dir) {
+    if (mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST)
+        exit_on_error("Could not create results directory: " + dir);
+}
+
+std::string ResultStore::key(const std::string& trace, const std::string& config) {
+    return std::string(SIM_VERSION) + "+" + SIM_MODEL_HASH + "|" + trace + "|" + config;
+}
+
+std::string ResultStore::path(const std::string& key) {
+    return dir + "/" + to_hex(fnv1a(key.data(), key.size())) + ".result";
+}
+
+bool ResultStore::load_value(const std::string& k, void* value, u64 len) {
+    FILE* f = fopen(path(k).c_str(), "rb");
+
+    if (f == nullptr)
+        return false;
+
+    char magic[4];
+    u64 key_len = 0, value_len = 0;
+    bool ok = fread(magic, sizeof(magic), 1, f) == 1 &&
+              memcmp(magic, RESULT_MAGIC, sizeof(magic)) == 0 &&
+              fread(&key_len, sizeof(key_len), 1, f) == 1 &&
+              key_len == k.size();
+
+    if (ok) {
+        std::string stored(key_len, '\0');
+
+        ok = fread(&stored[0], 1, key_len, f) == key_len && stored == k &&
+             fread(&value_len, sizeof(value_len), 1, f) == 1 &&
+             value_len == len &&
+             fread(value, len, 1, f) == 1;
+    }
+
+    fclose(f);
+
+    return ok;
+}
+
+void ResultStore::save_value(const std::string& k, const void* value, u64 len) {
+    std::string final_path = path(k);
+
+    // Unique per process; rename() makes the result appear atomically
+    std::string tmp = final_path + ".tmp." + std::to_string(getpid());
+    FILE* f = fopen(tmp.c_str(), "wb");
+
+    if (f == nullptr)
+        return;
+
+    u64 key_len = k.size();
+    bool ok = fwrite(RESULT_MAGIC, sizeof(RESULT_MAGIC), 1, f) == 1 &&
+              fwrite(&key_len, sizeof(key_len), 1, f) == 1 &&
+              fwrite(k.data(), 1, key_len, f) == key_len &&
+              fwrite(&len, sizeof(len), 1, f) == 1 &&
+              fwrite(value, len, 1, f) == 1;
+
+    ok = (fclose(f) == 0) && ok;
+
+    // A failed store only costs a future re-simulation
+    if (!ok || rename(tmp.c_str(), final_path.c_str()) != 0)
+        remove(tmp.c_str());
+}
+
+bool ResultStore::load(const std::string& trace, const std::string& config, cache_stats_t& out) {
+    return load_value(key(trace, config), &out, sizeof(out));
+}
+
+void ResultStore::save(const std::string& trace, const std::string& config, const cache_stats_t& stats) {
+    save_value(key(trace, config), &stats, sizeof(stats));
+}
+
+bool ResultStore::load_bound(const std::string& trace, const std::string& config, double& aat) {
+    return load_value(key(trace, config) + "|bound", &aat, sizeof(aat));
+}
+
+void ResultStore::save_bound(const std::string& trace, const std::string& config, double aat) {
+    save_value(key(trace, config) + "|bound", &aat, sizeof(aat));
+}
@@ -0,0 +1,58 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <string>
+
+#include "cache.hpp"
+#include "cachesim.hpp"
+
+// Bump whenever a change to the model can change any statistic, so stale
+// stored results are never returned. Keys also carry SIM_MODEL_HASH, a
+// checksum of the sources set by the Makefile, in case a bump is missed.
+static const char SIM_VERSION[] = "cachesim-2";
+
+// Trace part of a result key: FNV-1a hash of the file's bytes
+// Exits if the file cannot be read
+std::string file_key(const std::string& path);
+
+// Canonical text of a configuration: geometry plus any model options
+// (write policy, prefetcher, memory spec; empty = default)
+std::string config_key(const CacheSize& size, const std::string& write = "",
+                       const std::string& prefetcher = "", const std::string& memory = "");
+
+/**
+    On-disk store of finished simulations, one file per result.
+
+    Results are keyed by the trace (content hash or generator spec), the
+    config key and SIM_VERSION; the file name is a hash of that key and the
+    key itself is stored to rule out collisions. Files are written to a
+    temporary name and renamed into place, so parallel jobs sharing a
+    directory never see partial results (at worst both simulate and one
+    write wins).
+*/
+class ResultStore {
+public:
+    // Creates `dir` if needed
+    ResultStore(const std::string& dir);
+
+    // Fetch a stored result; false if there is none (or it is unreadable)
+    bool load(const std::string& trace, const std::string& config, cache_stats_t& out);
+
+    // Store a result (after compute_stats())
+    void save(const std::string& trace, const std::string& config, const cache_stats_t& stats);
+
+    // Lower bound on the AAT of a run that was abandoned (cacheopt)
+    bool load_bound(const std::string& trace, const std::string& config, double& aat);
+    void save_bound(const std::string& trace, const std::string& config, double aat);
+
+private:
+    std::string dir;
+
+    std::string key(const std::string& trace, const std::string& config);
+    std::string path(const std::string& key);
+
+    bool load_value(const std::string& key, void* value, u64 len);
+    void save_value(const std::string& key, const void* value, u64 len);
+};
+
+#endif
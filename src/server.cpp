@@ -0,0 +1,279 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "indexing.hpp"
+#include "server.hpp"
+#include "stats.hpp"
+#include "util.hpp" // exit_on_error
+
+// C includes
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static_assert(sizeof(Access) == 16, "Access records are sent as 16 bytes");
+
+void Session::build(const ServerConfig& config) {
+    stats = cache_stats_t();
+    cache = new Cache(config.size, find_cache_type(config.size), &stats);
+
+    cache->set_write_config(config.write);
+
+    if (!config.index.empty())
+        cache->set_index_function(parse_index(config.index));
+
+    if (!config.memory.empty()) {
+        memory = make_memory(config.memory, config.size.B);
+        cache->set_memory(memory);
+    }
+
+    if (!config.replacement.empty()) {
+        replacement = make_replacement(config.replacement);
+        cache->set_replacement(replacement);
+    }
+
+    if (!config.prefetcher.empty()) {
+        prefetcher = make_prefetcher(config.prefetcher, config.size.B);
+        cache->set_prefetcher(prefetcher);
+    }
+}
+
+void Session::destroy() {
+    delete cache;
+    delete prefetcher;
+    delete memory;
+    delete replacement;
+
+    cache = nullptr;
+    prefetcher = nullptr;
+    memory = nullptr;
+    replacement = nullptr;
+}
+
+// Once serving, a bad request fails that request instead of the server
+static void throw_error(const std::string& msg) {
+    throw std::runtime_error(msg);
+}
+
+static bool read_full(int fd, void* buf, size_t n) {
+    char* p = static_cast<char*>(buf);
+
+    while (n > 0) {
+        ssize_t r = read(fd, p, n);
+
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return false;
+
+        p += r;
+        n -= r;
+    }
+
+    return true;
+}
+
+static bool write_full(int fd, const void* buf, size_t n) {
+    const char* p = static_cast<const char*>(buf);
+
+    while (n > 0) {
+        // A client that went away must not SIGPIPE the server
+        ssize_t r = send(fd, p, n, MSG_NOSIGNAL);
+
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return false;
+
+        p += r;
+        n -= r;
+    }
+
+    return true;
+}
+
+static bool reply(int fd, uint32_t type, const void* payload = nullptr, size_t length = 0) {
+    FrameHeader h = {type, static_cast<uint32_t>(length)};
+    return write_full(fd, &h, sizeof(h)) && (length == 0 || write_full(fd, payload, length));
+}
+
+static bool reply_error(int fd, const std::string& msg) {
+    return reply(fd, FRAME_ERROR, msg.data(), msg.size());
+}
+
+SimServer::SimServer(const std::string& path, const ServerConfig& config) : path(path), config(config) {
+    // Bad configurations fail here, before any client connects
+    Session probe(config);
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path))
+        exit_on_error("Socket path too long: " + path);
+
+    strcpy(addr.sun_path, path.c_str());
+
+    // A socket left over from an earlier server would block bind()
+    unlink(path.c_str());
+
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listener, 64) != 0)
+        exit_on_error("Could not listen on " + path + ": " + strerror(errno));
+}
+
+SimServer::~SimServer() {
+    close(listener);
+    unlink(path.c_str());
+}
+
+void SimServer::run() {
+    set_error_handler(throw_error);
+
+    while (true) {
+        int fd = accept(listener, nullptr, nullptr);
+
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+
+            set_error_handler(nullptr);
+            exit_on_error(std::string("accept() failed: ") + strerror(errno));
+        }
+
+        std::thread(&SimServer::serve, this, fd).detach();
+    }
+}
+
+void SimServer::serve(int fd) {
+    std::shared_ptr<Session> session;
+    std::string name;
+    std::vector<char> payload;
+    FrameHeader h;
+
+    while (read_full(fd, &h, sizeof(h))) {
+        if (h.length > MAX_FRAME) {
+            reply_error(fd, "Frame too large.");
+            break;
+        }
+
+        payload.resize(h.length);
+
+        if (!read_full(fd, payload.data(), h.length))
+            break;
+
+        if (h.type == FRAME_OPEN) {
+            name.assign(payload.begin(), payload.end());
+
+            try {
+                if (name.empty()) {
+                    session = std::make_shared<Session>(config);
+                } else {
+                    std::lock_guard<std::mutex> guard(sessions_lock);
+                    std::shared_ptr<Session>& named = sessions[name];
+
+                    if (named == nullptr)
+                        named = std::make_shared<Session>(config);
+
+                    session = named;
+                }
+            } catch (const std::exception& e) {
+                session = nullptr;
+
+                if (!reply_error(fd, e.what()))
+                    break;
+                continue;
+            }
+
+            std::lock_guard<std::mutex> guard(session->lock);
+            u64 accesses = session->stats.accesses;
+
+            if (!reply(fd, FRAME_OK, &accesses, sizeof(accesses)))
+                break;
+            continue;
+        }
+
+        if (session == nullptr) {
+            if (!reply_error(fd, "No session open."))
+                break;
+            continue;
+        }
+
+        bool ok;
+
+        try {
+            std::lock_guard<std::mutex> guard(session->lock);
+
+            switch (h.type) {
+                case FRAME_ACCESS: {
+                    if (h.length % sizeof(Access) != 0)
+                        throw std::runtime_error("Access payload is not a whole number of records.");
+
+                    size_t n = h.length / sizeof(Access);
+                    const Access* records = reinterpret_cast<const Access*>(payload.data());
+
+                    // Repeat records only make sense within a reduced trace
+                    for (size_t i = 0; i < n; i++) {
+                        if (records[i].mode != READ && records[i].mode != WRITE)
+                            throw std::runtime_error("Unknown access mode.");
+                    }
+
+                    session->cache->access_batch(records, n);
+                    ok = reply(fd, FRAME_OK);
+                    break;
+                }
+                case FRAME_SNAPSHOT: {
+                    if (session->stats.accesses == 0)
+                        throw std::runtime_error("No accesses in this session yet.");
+
+                    session->cache->compute_stats();
+
+                    char* json = nullptr;
+                    size_t length = 0;
+                    FILE* out = open_memstream(&json, &length);
+
+                    print_results(out, &session->stats, config.size, FORMAT_JSON, name);
+                    fclose(out);
+
+                    ok = reply(fd, FRAME_STATS, json, length);
+                    free(json);
+                    break;
+                }
+                case FRAME_RESET:
+                    session->destroy();
+                    session->build(config);
+                    ok = reply(fd, FRAME_OK);
+                    break;
+                case FRAME_CLOSE: {
+                    std::lock_guard<std::mutex> guard(sessions_lock);
+                    auto it = sessions.find(name);
+
+                    if (it != sessions.end() && it->second == session)
+                        sessions.erase(it);
+
+                    ok = reply(fd, FRAME_OK);
+                    break;
+                }
+                default:
+                    throw std::runtime_error("Unknown frame type.");
+            }
+        } catch (const std::exception& e) {
+            ok = reply_error(fd, e.what());
+        }
+
+        // Detach after the lock on the session is released
+        if (h.type == FRAME_CLOSE)
+            session = nullptr;
+
+        if (!ok)
+            break;
+    }
+
+    close(fd);
+}
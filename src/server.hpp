@@ -0,0 +1,109 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "cache.hpp"
+#include "cachesim.hpp"
+#include "memory.hpp"
+#include "prefetch.hpp"
+#include "replacement.hpp"
+#include "writebuf.hpp"
+
+/*
+    Framed protocol of the simulation server. Every frame, in either
+    direction, is a FrameHeader followed by `length` payload bytes (host
+    byte order: clients are local). Requests are answered in order, so a
+    client may pipeline several, as long as it keeps reading the replies
+    (socket buffers are bounded).
+
+    FRAME_OPEN      name       Attach to session `name`, creating it if
+                               needed; "" = private session. Replies OK
+                               with the session's accesses so far (u64).
+    FRAME_ACCESS    records    Simulate n 16-byte records (layout of
+                               cachesim_access in libcachesim.h, modes
+                               'r' and 'w'). Replies OK.
+    FRAME_SNAPSHOT  -          Replies STATS: the session's statistics so
+                               far as a cachesim -f json object.
+    FRAME_RESET     -          Empty the session's cache, zero its stats.
+    FRAME_CLOSE     -          Detach and drop the session. Named sessions
+                               otherwise stay resident (and warm) after
+                               their clients disconnect.
+
+    Failed requests are answered with FRAME_ERROR and a message.
+*/
+enum FrameType : uint32_t {
+    FRAME_OPEN = 1,
+    FRAME_ACCESS = 2,
+    FRAME_SNAPSHOT = 3,
+    FRAME_RESET = 4,
+    FRAME_CLOSE = 5,
+
+    FRAME_OK = 128,
+    FRAME_STATS = 129,
+    FRAME_ERROR = 130
+};
+
+struct FrameHeader {
+    uint32_t type;
+    uint32_t length;
+};
+
+// Largest payload accepted (a client sending more is disconnected)
+static const uint32_t MAX_FRAME = 64 << 20;
+
+// Cache configuration every session is built from
+struct ServerConfig {
+    CacheSize size;
+    WriteConfig write;
+    std::string prefetcher, memory, replacement, index;
+};
+
+/**
+    One simulated cache and its statistics; used by one client at a time.
+*/
+struct Session {
+    std::mutex lock;
+    cache_stats_t stats = {};
+
+    Cache* cache = nullptr;
+    Prefetcher* prefetcher = nullptr;
+    MemoryBackend* memory = nullptr;
+    ReplacementPredictor* replacement = nullptr;
+
+    explicit Session(const ServerConfig& config) { build(config); }
+    ~Session() { destroy(); }
+
+    // Fresh cache and zero stats
+    void build(const ServerConfig& config);
+    void destroy();
+};
+
+/**
+    Simulation server on a Unix domain socket: one thread per client,
+    sessions kept in memory between clients (see FrameType).
+*/
+class SimServer {
+public:
+    // Exits if the configuration is invalid or `path` cannot be bound
+    SimServer(const std::string& path, const ServerConfig& config);
+    ~SimServer();
+
+    // Accept clients until the process is stopped
+    void run();
+
+private:
+    std::string path;
+    ServerConfig config;
+    int listener;
+
+    std::mutex sessions_lock;
+    std::map<std::string, std::shared_ptr<Session>> sessions;
+
+    void serve(int fd);
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cinttypes>
+
+#include "setstats.hpp"
+#include "util.hpp" // exit_on_error
+
+// Heatmap cells per row, and rows at most (larger caches sum sets per cell)
+static const u64 HEATMAP_WIDTH = 64;
+static const u64 HEATMAP_ROWS = 64;
+
+// Heatmap shades from no misses to the busiest cell
+static const char SHADES[] = " .:-=+*#%@";
+
+// Upper bounds of the histogram buckets, as multiples of the mean
+static const double BUCKETS[] = {0, 0.5, 1, 2, 4, 8};
+static const int NUM_BUCKETS = sizeof(BUCKETS) / sizeof(BUCKETS[0]);
+
+void print_set_report(FILE* out, const std::vector<SetCounters>& sets, int top) {
+    u64 n = sets.size(), accessed = 0, missed = 0, total = 0;
+
+    for (auto& s: sets) {
+        accessed += (s.accesses > 0);
+        missed += (s.misses > 0);
+        total += s.misses;
+    }
+
+    // Set numbers, most misses first
+    std::vector<u64> order(n);
+
+    for (u64 i = 0; i < n; i++)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(),
+                     [&](u64 a, u64 b) { return sets[a].misses > sets[b].misses; });
+
+    double mean = static_cast<double>(total) / n;
+
+    fprintf(out, "\nPer-Set Statistics\n");
+    fprintf(out, "==================\n");
+    fprintf(out, "Sets: %" PRIu64 " (%" PRIu64 " accessed, %" PRIu64 " with misses)\n", n, accessed, missed);
+
+    if (total == 0)
+        return;
+
+    fprintf(out, "Misses per set: mean %.2f, max %" PRIu64 " (set %" PRIu64 "), max / mean %.2f\n",
+            mean, sets[order[0]].misses, order[0], sets[order[0]].misses / mean);
+
+    // Share of all misses in the hottest sets
+    fprintf(out, "Misses in the hottest sets:");
+
+    for (double frac: {0.01, 0.1, 0.5}) {
+        u64 k = std::max<u64>(1, static_cast<u64>(n * frac)), sum = 0;
+
+        for (u64 i = 0; i < k; i++)
+            sum += sets[order[i]].misses;
+
+        fprintf(out, " %g%%: %.1f%%", frac * 100, 100.0 * sum / total);
+    }
+
+    fprintf(out, "\n\nMisses per set (x mean)  Sets  Share of misses\n");
+
+    for (int b = 0; b <= NUM_BUCKETS; b++) {
+        double lo = (b > 0) ? BUCKETS[b - 1] * mean : -1;
+        double hi = (b < NUM_BUCKETS) ? BUCKETS[b] * mean : 1e300;
+        u64 count = 0, sum = 0;
+
+        for (auto& s: sets) {
+            if (s.misses > lo && s.misses <= hi) {
+                count++;
+                sum += s.misses;
+            }
+        }
+
+        char label[32];
+
+        if (b == 0)
+            snprintf(label, sizeof(label), "0");
+        else if (b == NUM_BUCKETS)
+            snprintf(label, sizeof(label), "> %g", BUCKETS[b - 1]);
+        else
+            snprintf(label, sizeof(label), "(%g, %g]", BUCKETS[b - 1], BUCKETS[b]);
+
+        fprintf(out, "%-23s %6" PRIu64 " %15.1f%%\n", label, count, 100.0 * sum / total);
+    }
+
+    // Heatmap: consecutive sets per cell, rows of cells
+    u64 per_cell = (n + HEATMAP_WIDTH * HEATMAP_ROWS - 1) / (HEATMAP_WIDTH * HEATMAP_ROWS);
+    u64 cells = (n + per_cell - 1) / per_cell;
+    std::vector<u64> heat(cells, 0);
+
+    for (u64 i = 0; i < n; i++)
+        heat[i / per_cell] += sets[i].misses;
+
+    u64 hottest = *std::max_element(heat.begin(), heat.end());
+    int levels = sizeof(SHADES) - 2;
+
+    fprintf(out, "\nMiss heatmap (%" PRIu64 " set%s per cell, '%s' = 0 .. %" PRIu64 " misses)\n",
+            per_cell, per_cell > 1 ? "s" : "", SHADES, hottest);
+
+    for (u64 row = 0; row < cells; row += HEATMAP_WIDTH) {
+        fprintf(out, "%8" PRIu64 " |", row * per_cell);
+
+        for (u64 c = row; c < std::min(cells, row + HEATMAP_WIDTH); c++) {
+            // Any miss shows; the busiest cell gets the darkest shade
+            int shade = (heat[c] == 0) ? 0 : 1 + static_cast<int>((levels - 1) * heat[c] / hottest);
+            fputc(SHADES[shade], out);
+        }
+
+        fprintf(out, "|\n");
+    }
+
+    fprintf(out, "\nSet        Accesses     Misses  Miss rate  Evictions    VC hits  Writebacks  Share of misses\n");
+
+    for (u64 i = 0; i < std::min<u64>(top, n) && sets[order[i]].misses > 0; i++) {
+        const SetCounters& s = sets[order[i]];
+
+        fprintf(out, "%-8" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10.4f %10" PRIu64 " %10" PRIu64 " %11" PRIu64 " %15.2f%%\n",
+                order[i], s.accesses, s.misses, static_cast<double>(s.misses) / s.accesses,
+                s.evictions, s.vc_hits, s.write_backs, 100.0 * s.misses / total);
+    }
+}
+
+void write_set_counters(const std::string& path, const std::vector<SetCounters>& sets) {
+    FILE* f = fopen(path.c_str(), "w");
+
+    if (f == nullptr)
+        exit_on_error("Could not open set counter file: " + path);
+
+    fprintf(f, "set,accesses,misses,evictions,vc_hits,write_backs\n");
+
+    for (u64 i = 0; i < sets.size(); i++) {
+        const SetCounters& s = sets[i];
+
+        fprintf(f, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                i, s.accesses, s.misses, s.evictions, s.vc_hits, s.write_backs);
+    }
+
+    fclose(f);
+}
@@ -0,0 +1,17 @@
+#ifndef SETSTATS_H
+#define SETSTATS_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "cache.hpp"
+
+// Concentration, histogram and heatmap of misses over the sets, and the
+// `top` sets with the most misses
+void print_set_report(FILE* out, const std::vector<SetCounters>& sets, int top);
+
+// Every set's counters as CSV (set,accesses,misses,evictions,vc_hits,write_backs)
+void write_set_counters(const std::string& path, const std::vector<SetCounters>& sets);
+
+#endif
@@ -0,0 +1,314 @@
+#include <cstddef>
+
+#include "cache.hpp"
+#include "stats.hpp"
+#include "util.hpp" // exit_on_error
+
+/**
+    Describes one field of cache_stats_t for every output format.
+*/
+struct StatField {
+    const char* key;   // Machine-readable name (CSV/JSON)
+    const char* label; // Human-readable label (text)
+    bool real;         // double instead of uint64_t
+    size_t offset;
+    bool optional;     // Text output skips it while zero (feature disabled)
+};
+
+#define STAT_U64(key, label) { #key, label, false, offsetof(cache_stats_t, key), false }
+#define STAT_F64(key, label) { #key, label, true, offsetof(cache_stats_t, key), false }
+#define OPT_U64(key, label) { #key, label, false, offsetof(cache_stats_t, key), true }
+#define OPT_F64(key, label) { #key, label, true, offsetof(cache_stats_t, key), true }
+
+static const StatField STAT_FIELDS[] = {
+    STAT_U64(accesses, "Accesses"),
+    STAT_U64(reads, "Reads"),
+    STAT_U64(read_misses, "Read misses"),
+    STAT_U64(read_misses_combined, "Read misses combined"),
+    STAT_U64(writes, "Writes"),
+    STAT_U64(write_misses, "Write misses"),
+    STAT_U64(write_misses_combined, "Write misses combined"),
+    STAT_U64(misses, "Misses"),
+    STAT_U64(write_backs, "Writebacks"),
+    STAT_U64(vc_misses, "Victim cache misses"),
+    STAT_U64(subblock_misses, "Sub-block misses"),
+    STAT_U64(bytes_transferred, "Bytes transferred to/from memory"),
+    STAT_F64(hit_time, "Hit Time"),
+    STAT_F64(miss_penalty, "Miss Penalty"),
+    STAT_F64(miss_rate, "Miss rate"),
+    STAT_F64(avg_access_time, "Average access time (AAT)"),
+    OPT_U64(prefetches, "Prefetches issued"),
+    OPT_U64(prefetch_hits, "Useful prefetches"),
+    OPT_U64(stream_hits, "Stream buffer hits"),
+    OPT_U64(prefetch_unused, "Unused prefetches (pollution)"),
+    OPT_U64(prefetch_bytes, "Prefetch bytes transferred"),
+    OPT_F64(prefetch_accuracy, "Prefetch accuracy"),
+    OPT_F64(prefetch_coverage, "Prefetch coverage"),
+    OPT_U64(write_throughs, "Write-throughs"),
+    OPT_U64(write_bypasses, "Write bypasses (no-write-allocate)"),
+    OPT_U64(wbuf_writes, "Write buffer entries allocated"),
+    OPT_U64(wbuf_coalesced, "Write buffer coalesced writes"),
+    OPT_U64(wbuf_stalls, "Write buffer full stalls"),
+    OPT_U64(wbuf_max_occupancy, "Write buffer max occupancy"),
+    OPT_F64(write_stall_cycles, "Write stall cycles"),
+    OPT_F64(wbuf_occupancy, "Write buffer average occupancy"),
+    OPT_F64(wbuf_coalesce_rate, "Write buffer coalesce rate"),
+    OPT_U64(mem_reads, "Memory reads (demand)"),
+    OPT_U64(mem_writes, "Memory writes"),
+    OPT_U64(mshr_merges, "MSHR merges"),
+    OPT_U64(mshr_stalls, "MSHR full stalls"),
+    OPT_U64(row_hits, "DRAM row hits"),
+    OPT_U64(row_misses, "DRAM row misses"),
+    OPT_U64(row_conflicts, "DRAM row conflicts"),
+    OPT_F64(miss_cycles, "Total miss latency (cycles)"),
+    OPT_F64(mshr_stall_cycles, "MSHR stall cycles"),
+    OPT_U64(evicted_by_others, "Blocks evicted by other programs"),
+    OPT_U64(sets_used, "Sets used"),
+    OPT_U64(split_accesses, "Accesses split across blocks"),
+    OPT_U64(predicted_dead, "Blocks predicted dead"),
+    OPT_U64(dead_mispredictions, "Hits on predicted-dead blocks"),
+    OPT_F64(set_fill_imbalance, "Busiest set fills / mean"),
+    OPT_U64(tlb_l1_misses, "L1 TLB misses"),
+    OPT_U64(tlb_walks, "Page walks (L2 TLB misses)"),
+    OPT_U64(pwc_hits, "Page-walk cache hits"),
+    OPT_U64(walk_accesses, "Page walk accesses"),
+    OPT_U64(walk_misses, "Page walk accesses missing the cache"),
+    OPT_U64(thp_promotions, "Huge page promotions"),
+    OPT_F64(translation_cycles, "Translation cycles"),
+    OPT_F64(effective_capacity, "Effective capacity (bytes)"),
+    OPT_F64(capacity_ratio, "Effective / physical capacity"),
+    OPT_U64(metadata_bits, "Metadata bits"),
+    OPT_F64(metadata_ratio, "Metadata bits / conventional"),
+};
+
+static const int NUM_STAT_FIELDS = sizeof(STAT_FIELDS) / sizeof(STAT_FIELDS[0]);
+
+static u64 get_u64(const cache_stats_t* stats, const StatField& f) {
+    return *reinterpret_cast<const u64*>(reinterpret_cast<const char*>(stats) + f.offset);
+}
+
+static double get_f64(const cache_stats_t* stats, const StatField& f) {
+    return *reinterpret_cast<const double*>(reinterpret_cast<const char*>(stats) + f.offset);
+}
+
+bool find_stat(const cache_stats_t& stats, const std::string& key, double& value) {
+    for (int i = 0; i < NUM_STAT_FIELDS; i++) {
+        const StatField& f = STAT_FIELDS[i];
+
+        if (key == f.key) {
+            value = f.real ? get_f64(&stats, f) : static_cast<double>(get_u64(&stats, f));
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void add_stats(cache_stats_t& into, const cache_stats_t& from) {
+    for (int i = 0; i < NUM_STAT_FIELDS; i++) {
+        const StatField& f = STAT_FIELDS[i];
+
+        if (!f.real)
+            *reinterpret_cast<u64*>(reinterpret_cast<char*>(&into) + f.offset) += get_u64(&from, f);
+    }
+
+    // Cycle totals are doubles but add up like the counters
+    into.write_stall_cycles += from.write_stall_cycles;
+    into.miss_cycles += from.miss_cycles;
+    into.mshr_stall_cycles += from.mshr_stall_cycles;
+    into.translation_cycles += from.translation_cycles;
+}
+
+StatsFormat parse_format(const std::string& s) {
+    if (s == "text")
+        return FORMAT_TEXT;
+    else if (s == "csv")
+        return FORMAT_CSV;
+    else if (s == "json")
+        return FORMAT_JSON;
+
+    exit_on_error("Unknown output format: " + s);
+    return FORMAT_TEXT;
+}
+
+void print_statistics(cache_stats_t* p_stats, FILE* out) {
+    fprintf(out, "\nCache Statistics\n");
+    fprintf(out, "================\n");
+
+    for (int i = 0; i < NUM_STAT_FIELDS; i++) {
+        const StatField& f = STAT_FIELDS[i];
+
+        if (f.optional && (f.real ? get_f64(p_stats, f) == 0 : get_u64(p_stats, f) == 0))
+            continue;
+
+        if (f.real)
+            fprintf(out, "%s: %f\n", f.label, get_f64(p_stats, f));
+        else
+            fprintf(out, "%s: %" PRIu64 "\n", f.label, get_u64(p_stats, f));
+    }
+}
+
+// `s` as the contents of a JSON string
+static std::string json_escape(const std::string& s) {
+    std::string out;
+
+    for (char ch: s) {
+        unsigned char c = static_cast<unsigned char>(ch);
+
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += ch;
+        }
+    }
+
+    return out;
+}
+
+void print_results(FILE* out, const cache_stats_t* stats, const CacheSize& size, StatsFormat fmt,
+                   const std::string& trace, bool header) {
+    int i;
+
+    switch (fmt) {
+        case FORMAT_TEXT:
+            print_statistics(const_cast<cache_stats_t*>(stats), out);
+            break;
+        case FORMAT_CSV:
+            if (header) {
+                fprintf(out, "trace,C,B,S,K,V");
+                for (i = 0; i < NUM_STAT_FIELDS; i++)
+                    fprintf(out, ",%s", STAT_FIELDS[i].key);
+                fprintf(out, "\n");
+            }
+
+            fprintf(out, "%s,", trace.c_str());
+            fprintf(out, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64,
+                    size.C, size.B, size.S, size.K, size.V);
+            for (i = 0; i < NUM_STAT_FIELDS; i++) {
+                const StatField& f = STAT_FIELDS[i];
+                if (f.real)
+                    fprintf(out, ",%f", get_f64(stats, f));
+                else
+                    fprintf(out, ",%" PRIu64, get_u64(stats, f));
+            }
+            fprintf(out, "\n");
+            break;
+        case FORMAT_JSON:
+            fprintf(out, "{\"type\":\"result\",\"trace\":\"%s\",\"C\":%" PRIu64 ",\"B\":%" PRIu64 ",\"S\":%" PRIu64
+                    ",\"K\":%" PRIu64 ",\"V\":%" PRIu64,
+                    json_escape(trace).c_str(), size.C, size.B, size.S, size.K, size.V);
+            for (i = 0; i < NUM_STAT_FIELDS; i++) {
+                const StatField& f = STAT_FIELDS[i];
+                if (f.real)
+                    fprintf(out, ",\"%s\":%f", f.key, get_f64(stats, f));
+                else
+                    fprintf(out, ",\"%s\":%" PRIu64, f.key, get_u64(stats, f));
+            }
+            fprintf(out, "}\n");
+            break;
+    }
+
+    fflush(out);
+}
+
+IntervalWriter::IntervalWriter(FILE* out, StatsFormat fmt, bool vc) :
+            out(out), fmt(fmt), vc(vc) {
+    // Intervals are always machine-readable
+    if (this->fmt == FORMAT_TEXT)
+        this->fmt = FORMAT_CSV;
+
+    if (this->fmt == FORMAT_CSV)
+        fprintf(out, "interval,end,accesses,reads,writes,misses,miss_rate,"
+                     "write_backs,bytes_transferred,vc_hits,subblock_misses\n");
+
+    worker = std::thread(&IntervalWriter::run, this);
+}
+
+IntervalWriter::~IntervalWriter() {
+    close();
+}
+
+void IntervalWriter::snapshot(const cache_stats_t& stats) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queue.push_back(stats);
+    }
+
+    cv.notify_one();
+}
+
+void IntervalWriter::close() {
+    if (!worker.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        done = true;
+    }
+
+    cv.notify_one();
+    worker.join();
+    fflush(out);
+}
+
+void IntervalWriter::run() {
+    std::deque<cache_stats_t> batch;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            cv.wait(guard, [this] { return done || !queue.empty(); });
+
+            if (queue.empty() && done)
+                break;
+
+            // Take everything queued so far; format outside the lock
+            batch.swap(queue);
+        }
+
+        for (auto& s: batch)
+            write(s);
+
+        batch.clear();
+    }
+}
+
+void IntervalWriter::write(const cache_stats_t& cur) {
+    // Deltas since the previous snapshot
+    u64 accesses = cur.accesses - prev.accesses;
+    u64 reads = cur.reads - prev.reads;
+    u64 writes = cur.writes - prev.writes;
+    u64 misses = (cur.read_misses + cur.write_misses) - (prev.read_misses + prev.write_misses);
+    u64 vc_misses = cur.vc_misses - prev.vc_misses;
+    u64 sb_misses = cur.subblock_misses - prev.subblock_misses;
+    u64 write_backs = cur.write_backs - prev.write_backs;
+    u64 bytes = cur.bytes_transferred - prev.bytes_transferred;
+
+    // Same definition as Cache::compute_stats()
+    u64 vc_hits = vc ? misses - vc_misses : 0;
+    u64 effective = vc ? vc_misses + sb_misses : misses + sb_misses;
+    double miss_rate = accesses ? static_cast<double>(effective) / accesses : 0.0;
+
+    if (fmt == FORMAT_CSV) {
+        fprintf(out, "%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64
+                     ",%f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 "\n",
+                count, cur.accesses, accesses, reads, writes, misses,
+                miss_rate, write_backs, bytes, vc_hits, sb_misses);
+    } else {
+        fprintf(out, "{\"type\":\"interval\",\"interval\":%" PRIu64 ",\"end\":%" PRIu64
+                     ",\"accesses\":%" PRIu64 ",\"reads\":%" PRIu64 ",\"writes\":%" PRIu64
+                     ",\"misses\":%" PRIu64 ",\"miss_rate\":%f,\"write_backs\":%" PRIu64
+                     ",\"bytes_transferred\":%" PRIu64 ",\"vc_hits\":%" PRIu64
+                     ",\"subblock_misses\":%" PRIu64 "}\n",
+                count, cur.accesses, accesses, reads, writes, misses,
+                miss_rate, write_backs, bytes, vc_hits, sb_misses);
+    }
+
+    prev = cur;
+    count++;
+}
@@ -0,0 +1,73 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "cachesim.hpp"
+
+struct CacheSize;
+
+// Output formats for statistics
+enum StatsFormat {
+    FORMAT_TEXT,
+    FORMAT_CSV,
+    FORMAT_JSON
+};
+
+// Parse "text", "csv" or "json"; exits on anything else
+StatsFormat parse_format(const std::string& s);
+
+// Look up a field by its CSV/JSON key; false if there is no such field
+bool find_stat(const cache_stats_t& stats, const std::string& key, double& value);
+
+// Add the counters (not the derived values) of `from` to `into`
+void add_stats(cache_stats_t& into, const cache_stats_t& from);
+
+// Human-readable summary (the original cachesim output)
+void print_statistics(cache_stats_t* p_stats, FILE* out = stdout);
+
+// Final results in the requested format, tagged with the trace and cache geometry
+// `header` controls the CSV header line (print it once per table)
+void print_results(FILE* out, const cache_stats_t* stats, const CacheSize& size, StatsFormat fmt,
+                   const std::string& trace = "", bool header = true);
+
+/**
+    Emits a time series of statistics deltas, one record every N accesses.
+
+    The simulation loop only calls snapshot(), which copies the counters
+    into a queue. Formatting and I/O happen on a background thread.
+*/
+class IntervalWriter {
+public:
+    IntervalWriter(FILE* out, StatsFormat fmt, bool vc);
+    ~IntervalWriter();
+
+    // Queue a copy of the current (cumulative) counters
+    void snapshot(const cache_stats_t& stats);
+
+    // Drain the queue and join the writer thread
+    void close();
+
+private:
+    FILE* out;
+    StatsFormat fmt;
+    bool vc;
+
+    std::deque<cache_stats_t> queue;
+    std::mutex lock;
+    std::condition_variable cv;
+    bool done = false;
+    std::thread worker;
+
+    cache_stats_t prev = {};
+    u64 count = 0;
+
+    void run();
+    void write(const cache_stats_t& cur);
+};
+
+#endif
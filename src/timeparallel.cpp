@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <thread>
+
+#include "stats.hpp"
+#include "timeparallel.hpp"
+#include "util.hpp" // exit_on_error
+
+// Checkpoints per segment at most (bounds the saved states)
+static const size_t MAX_CHECKPOINTS = 32;
+
+TimeParallelSim::TimeParallelSim(CacheSize size, const WriteConfig& write, int segments, int threads) :
+            size(size), write(write), segments(segments), threads(threads) {
+    if (segments < 1 || threads < 1)
+        exit_on_error("Need at least one segment and one thread.");
+    if (write.buffer > 0)
+        exit_on_error("Time-parallel simulation does not support write buffers.");
+}
+
+void TimeParallelSim::run_segment(const std::vector<Access>& trace, Segment& seg) {
+    seg.stats.assign(seg.checkpoints.size(), cache_stats_t());
+    seg.states.resize(seg.checkpoints.size());
+
+    seg.cache = new Cache(size, find_cache_type(size), &seg.stats[0]);
+    seg.cache->set_write_config(write);
+
+    // Write-throughs stall for the miss penalty the constructor set
+    for (auto& cs: seg.stats) {
+        cs.hit_time = seg.stats[0].hit_time;
+        cs.miss_penalty = seg.stats[0].miss_penalty;
+    }
+
+    size_t pos = seg.begin;
+
+    for (size_t c = 0; c < seg.checkpoints.size(); c++) {
+        seg.cache->set_stats(&seg.stats[c]);
+        seg.cache->access_batch(trace.data() + pos, seg.checkpoints[c] - pos);
+        pos = seg.checkpoints[c];
+
+        // The first segment starts from the true (empty) state
+        if (seg.begin > 0)
+            seg.cache->save_state(seg.states[c]);
+    }
+}
+
+void TimeParallelSim::run(const std::vector<Access>& trace, cache_stats_t& stats) {
+    size_t n = trace.size();
+
+    // Convergence takes at least about one cache worth of misses
+    size_t frames = (static_cast<size_t>(1) << (size.C - size.B)) + size.V;
+    size_t spacing = std::max<size_t>(2 * frames, 1024);
+    size_t k = std::max<size_t>(1, std::min<size_t>(segments, n / (2 * spacing)));
+
+    std::vector<Segment> segs(k);
+
+    for (size_t i = 0; i < k; i++) {
+        Segment& seg = segs[i];
+
+        // Repeat records refer to the record before them: never start on one
+        seg.begin = (i == 0) ? 0 : std::max(segs[i - 1].begin, n * i / k);
+        while (i > 0 && seg.begin < n && trace[seg.begin].mode == REPEAT)
+            seg.begin++;
+
+        if (i > 0)
+            segs[i - 1].end = seg.begin;
+    }
+
+    segs[k - 1].end = n;
+
+    for (auto& seg: segs) {
+        size_t step = std::max(spacing, (seg.end - seg.begin) / MAX_CHECKPOINTS + 1);
+
+        for (size_t pos = seg.begin; pos < seg.end; ) {
+            pos = std::min(pos + step, seg.end);
+            seg.checkpoints.push_back(pos);
+        }
+    }
+
+    // Every segment from an empty cache, concurrently
+    int t = std::max(1, std::min(threads, static_cast<int>(k)));
+    std::vector<std::thread> pool;
+
+    for (int i = 0; i < t; i++) {
+        pool.emplace_back([&, i]() {
+            for (size_t s = i; s < k; s += t)
+                run_segment(trace, segs[s]);
+        });
+    }
+
+    for (auto& th: pool)
+        th.join();
+
+    // Fix-up: carry the true state from segment to segment
+    cache_stats_t total = {};
+    Cache* carrier = segs[0].cache;
+    std::vector<u64> state;
+
+    total.hit_time = segs[0].stats[0].hit_time;
+    total.miss_penalty = segs[0].stats[0].miss_penalty;
+
+    for (auto& cs: segs[0].stats)
+        add_stats(total, cs);
+
+    for (size_t i = 1; i < k; i++) {
+        Segment& seg = segs[i];
+        cache_stats_t fix = {};
+        size_t pos = seg.begin, c;
+        bool converged = false;
+
+        if (seg.checkpoints.empty()) {
+            delete seg.cache;
+            continue;
+        }
+
+        fix.hit_time = total.hit_time;
+        fix.miss_penalty = total.miss_penalty;
+
+        carrier->set_stats(&fix);
+
+        for (c = 0; c < seg.checkpoints.size(); c++) {
+            carrier->access_batch(trace.data() + pos, seg.checkpoints[c] - pos);
+            fixup += seg.checkpoints[c] - pos;
+            pos = seg.checkpoints[c];
+
+            state.clear();
+            carrier->save_state(state);
+
+            if (state == seg.states[c]) {
+                converged = true;
+                break;
+            }
+        }
+
+        add_stats(total, fix);
+
+        if (converged) {
+            // The segment's own run is exact from checkpoint c on
+            for (size_t j = c + 1; j < seg.stats.size(); j++)
+                add_stats(total, seg.stats[j]);
+
+            delete carrier;
+            carrier = seg.cache;
+        } else {
+            missed++;
+            delete seg.cache;
+        }
+    }
+
+    stats = total;
+    carrier->set_stats(&stats);
+    carrier->compute_stats();
+
+    delete carrier;
+}
@@ -0,0 +1,57 @@
+#ifndef TIMEPARALLEL_H
+#define TIMEPARALLEL_H
+
+#include <vector>
+
+#include "cache.hpp"
+#include "writebuf.hpp"
+
+/**
+    Time-parallel simulation of one cache over one trace.
+
+    The trace is cut into segments that are simulated concurrently, each
+    from an empty cache, saving its state (see Cache::save_state()) and
+    counting its stats separately at checkpoints along the way. A fix-up
+    pass then walks the segments in order with a cache holding the true
+    state: it re-simulates the start of each segment until its state
+    equals the segment's own at a checkpoint. From there on the segment's
+    run was exact, so its stats after that checkpoint are used as they are
+    and its cache carries the true state into the next segment.
+
+    Results are identical to a serial run. Works for any geometry and
+    victim cache and any write policy without a write buffer; not for
+    prefetchers, memory models, PC predictors or set index functions,
+    whose state is not compared.
+*/
+class TimeParallelSim {
+public:
+    TimeParallelSim(CacheSize size, const WriteConfig& write, int segments, int threads);
+
+    // Simulate all of `trace` into `stats` (computed, like a serial run)
+    void run(const std::vector<Access>& trace, cache_stats_t& stats);
+
+    // Records the fix-up pass simulated again, and segments it had to
+    // re-simulate completely (their state never matched)
+    u64 fixup_records() const { return fixup; }
+    int unconverged() const { return missed; }
+
+private:
+    CacheSize size;
+    WriteConfig write;
+    int segments, threads;
+
+    u64 fixup = 0;
+    int missed = 0;
+
+    struct Segment {
+        size_t begin, end;
+        std::vector<size_t> checkpoints;          // Record after each interval
+        std::vector<std::vector<u64>> states;     // State at each checkpoint
+        std::vector<cache_stats_t> stats;         // Stats of each interval
+        Cache* cache = nullptr;
+    };
+
+    void run_segment(const std::vector<Access>& trace, Segment& seg);
+};
+
+#endif
@@ -0,0 +1,253 @@
+#include <cstdlib>
+
+#include "tlb.hpp"
+#include "util.hpp" // exit_on_error
+
+// Address bits below each page table level's index (PML4, PDPT, PD, PT)
+static const int LEVEL_SHIFT[4] = {39, 30, 21, 12};
+
+// Marks a used TLB or page-walk cache entry (keys are never 0 then)
+static const u64 VALID = 1ULL << 63;
+
+// Entry for `addr` at page table `level`: the index bits above that
+// level's shift, tagged with the level (a leaf level is the page size)
+static inline u64 entry_key(u64 addr, int level) {
+    return VALID | ((addr >> LEVEL_SHIFT[level]) << 2) | level;
+}
+
+// Physical address of the page table entry for `addr` at `level`. Each
+// level is one flat table in its own region, far above trace addresses,
+// so neighbouring pages have neighbouring entries (sharing blocks).
+static inline u64 pte_addr(u64 addr, int level) {
+    return (static_cast<u64>(8 + level) << 56) | ((addr >> LEVEL_SHIFT[level]) << 3);
+}
+
+TlbConfig parse_tlb(const std::string& spec) {
+    SpecOptions opts;
+    std::string kind = parse_spec(spec, opts);
+    TlbConfig cfg;
+
+    if (kind == "4k")
+        cfg.pages = PAGES_4K;
+    else if (kind == "2m")
+        cfg.pages = PAGES_2M;
+    else if (kind == "1g")
+        cfg.pages = PAGES_1G;
+    else if (kind == "thp")
+        cfg.pages = PAGES_THP;
+    else
+        exit_on_error("Unknown page size policy: " + kind);
+
+    for (auto& kv: opts) {
+        const std::string& key = kv.first;
+        const std::string& val = kv.second;
+
+        if (key == "promote" && kind == "thp")
+            cfg.promote = parse_size(val, 1);
+        else if (key == "l1")
+            cfg.l1_entries = parse_size(val, 1);
+        else if (key == "l1ways")
+            cfg.l1_ways = parse_size(val, 1);
+        else if (key == "l2")
+            cfg.l2_entries = parse_size(val, 1);
+        else if (key == "l2ways")
+            cfg.l2_ways = parse_size(val, 1);
+        else if (key == "l2lat")
+            cfg.l2_latency = atof(val.c_str());
+        else if (key == "pwc")
+            cfg.pwc_entries = parse_size(val, 1);
+        else
+            exit_on_error("Unknown TLB option: " + key + "=" + val);
+    }
+
+    if (cfg.l1_entries == 0 || cfg.l1_ways == 0 || cfg.l1_entries % cfg.l1_ways != 0)
+        exit_on_error("L1 TLB entries must be a nonzero multiple of its ways.");
+    if (cfg.l2_entries > 0 && (cfg.l2_ways == 0 || cfg.l2_entries % cfg.l2_ways != 0))
+        exit_on_error("L2 TLB entries must be a multiple of its ways.");
+    if (cfg.promote == 0 || cfg.promote > 512)
+        exit_on_error("promote must be between 1 and 512 pages.");
+
+    return cfg;
+}
+
+TlbArray::TlbArray(u64 entries, u64 ways) : sets(ways > 0 ? entries / ways : 0), ways(ways),
+            keys(entries, 0), stamps(entries, 0) {
+}
+
+bool TlbArray::lookup(u64 key) {
+    u64 base = (((key & ~VALID) >> 2) % sets) * ways;
+
+    for (u64 w = base; w < base + ways; w++) {
+        if (keys[w] == key) {
+            stamps[w] = ++clock;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void TlbArray::insert(u64 key) {
+    u64 base = (((key & ~VALID) >> 2) % sets) * ways;
+    u64 victim = base;
+
+    // An empty entry, or else the least recently used one
+    for (u64 w = base; w < base + ways; w++) {
+        if (keys[w] == 0) {
+            victim = w;
+            break;
+        }
+
+        if (stamps[w] < stamps[victim])
+            victim = w;
+    }
+
+    keys[victim] = key;
+    stamps[victim] = ++clock;
+}
+
+Tlb::Tlb(const TlbConfig& config, Cache* cache, cache_stats_t* stats) :
+            config(config), cache(cache), stats(stats),
+            l1(config.l1_entries, config.l1_ways),
+            l2(config.l2_entries, config.l2_ways),
+            pwc(config.pwc_entries, config.pwc_entries) {
+    // Walk accesses cost what data accesses do
+    walk_stats.hit_time = stats->hit_time;
+    walk_stats.miss_penalty = stats->miss_penalty;
+}
+
+int Tlb::leaf_level(u64 addr) {
+    switch (config.pages) {
+        case PAGES_4K:
+            return 3;
+        case PAGES_2M:
+            return 2;
+        case PAGES_1G:
+            return 1;
+        case PAGES_THP:
+            break;
+    }
+
+    u64 region = addr >> LEVEL_SHIFT[2];
+
+    if (huge.count(region) > 0)
+        return 2;
+
+    if (touched.insert(addr >> LEVEL_SHIFT[3]).second && ++region_pages[region] >= config.promote) {
+        promote(region);
+        return 2;
+    }
+
+    return 3;
+}
+
+void Tlb::promote(u64 region) {
+    huge.insert(region);
+    region_pages.erase(region);
+    stats->thp_promotions++;
+
+    for (u64 page = region << 9; page < (region + 1) << 9; page++)
+        touched.erase(page);
+
+    // Shoot down the region's 4K translations, and its PD entry, which
+    // pointed to the page table the huge page replaces
+    auto stale = [region](u64 key) {
+        return (key & 3) == 3 && ((key & ~VALID) >> 2) >> 9 == region;
+    };
+
+    l1.invalidate(stale);
+
+    if (l2.enabled())
+        l2.invalidate(stale);
+
+    if (pwc.enabled())
+        pwc.invalidate([region](u64 key) { return key == entry_key(region << LEVEL_SHIFT[2], 2); });
+}
+
+void Tlb::translate(u64 addr) {
+    int leaf = leaf_level(addr);
+    u64 key = entry_key(addr, leaf);
+
+    if (l1.lookup(key))
+        return;
+
+    stats->tlb_l1_misses++;
+
+    if (l2.enabled()) {
+        l2_lookups++;
+
+        if (l2.lookup(key)) {
+            l1.insert(key);
+            return;
+        }
+    }
+
+    stats->tlb_walks++;
+    walk(addr, leaf);
+
+    if (l2.enabled())
+        l2.insert(key);
+
+    l1.insert(key);
+}
+
+void Tlb::walk(u64 addr, int leaf) {
+    int start = 0;
+
+    // Resume below the deepest non-leaf entry the walk cache has
+    if (pwc.enabled()) {
+        for (int level = leaf - 1; level >= 0; level--) {
+            if (pwc.lookup(entry_key(addr, level))) {
+                start = level + 1;
+                stats->pwc_hits++;
+                break;
+            }
+        }
+    }
+
+    cache->set_stats(&walk_stats);
+
+    for (int level = start; level <= leaf; level++) {
+        cache->access({pte_addr(addr, level), READ});
+
+        if (level < leaf && pwc.enabled())
+            pwc.insert(entry_key(addr, level));
+    }
+
+    cache->set_stats(stats);
+}
+
+// Memory traffic a walk causes (fills, and the data blocks it evicts)
+static u64 cache_stats_t::* const WALK_TRAFFIC[] = {
+    &cache_stats_t::write_backs,
+    &cache_stats_t::bytes_transferred,
+    &cache_stats_t::prefetches,
+    &cache_stats_t::prefetch_bytes,
+    &cache_stats_t::mem_reads,
+    &cache_stats_t::mem_writes,
+    &cache_stats_t::mshr_merges,
+    &cache_stats_t::mshr_stalls,
+    &cache_stats_t::row_hits,
+    &cache_stats_t::row_misses,
+    &cache_stats_t::row_conflicts,
+};
+
+void Tlb::finish() {
+    stats->walk_accesses = walk_stats.accesses;
+    stats->translation_cycles = l2_lookups * config.l2_latency;
+
+    if (walk_stats.accesses > 0) {
+        cache->set_stats(&walk_stats);
+        cache->compute_stats();
+        cache->set_stats(stats);
+
+        stats->walk_misses = walk_stats.misses;
+        stats->translation_cycles += walk_stats.accesses * walk_stats.avg_access_time;
+
+        for (auto field: WALK_TRAFFIC)
+            stats->*field += walk_stats.*field;
+    }
+
+    if (stats->accesses > 0)
+        stats->avg_access_time += stats->translation_cycles / stats->accesses;
+}
@@ -0,0 +1,112 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cache.hpp"
+#include "cachesim.hpp"
+
+// Which page size backs each address
+enum PagePolicy {
+    PAGES_4K,
+    PAGES_2M,
+    PAGES_1G,
+    PAGES_THP   // 4K, until enough of a 2M region is touched to promote it
+};
+
+struct TlbConfig {
+    PagePolicy pages = PAGES_4K;
+    u64 promote = 64;        // PAGES_THP: 4K pages touched in a 2M region before promotion
+    u64 l1_entries = 64, l1_ways = 4;
+    u64 l2_entries = 1536, l2_ways = 12;  // 0 entries = no L2 TLB
+    double l2_latency = 7;   // Cycles per L2 TLB lookup (L1 lookups are free)
+    u64 pwc_entries = 32;    // Page-walk cache entries (0 = none)
+};
+
+// Parse "4k|2m|1g|thp[:promote=N,l1=N,l1ways=W,l2=N,l2ways=W,l2lat=C,pwc=N]"
+TlbConfig parse_tlb(const std::string& spec);
+
+/**
+    One set-associative TLB array (or, with one set, a fully associative
+    cache of page-walk entries), LRU within each set.
+*/
+class TlbArray {
+public:
+    TlbArray(u64 entries, u64 ways);
+
+    // Hit? (and make `key` the set's MRU)
+    bool lookup(u64 key);
+    void insert(u64 key);
+
+    // Drop every entry `match` accepts
+    template <class F>
+    void invalidate(F match) {
+        for (auto& k: keys) {
+            if (k != 0 && match(k))
+                k = 0;
+        }
+    }
+
+    bool enabled() const { return !keys.empty(); }
+
+private:
+    u64 sets, ways;
+    std::vector<u64> keys;    // [set * ways + way], 0 = empty
+    std::vector<u64> stamps;  // Last use of each entry
+    u64 clock = 0;
+};
+
+/**
+    Address translation in front of a Cache.
+
+    Trace addresses are taken as virtual addresses, translated through a
+    two-level TLB; the cache keeps using them as they are. A miss in both
+    levels walks a four-level x86-64 style radix page table whose entries
+    live in their own region of the address space: every entry read is a
+    real read access to the cache, so walks compete with the data for
+    blocks. The page-walk cache holds non-leaf entries (PML4, PDPT and PD
+    entries pointing to a lower table) and lets walks skip the levels
+    above the deepest one it has.
+
+    Walk accesses are counted in separate stats, not in the data stats.
+    finish() turns L2 TLB lookups and walk accesses (at the cache's AAT
+    for them) into translation cycles and adds them to the data AAT, and
+    adds the walks' memory traffic (including writebacks of the data
+    blocks they evict) to the data stats.
+*/
+class Tlb {
+public:
+    // `stats` are the data stats the cache is counting into
+    Tlb(const TlbConfig& config, Cache* cache, cache_stats_t* stats);
+
+    // Translate the address of one data access (before the access)
+    void translate(u64 addr);
+
+    // Add the translation cost to the stats; after Cache::compute_stats()
+    void finish();
+
+private:
+    TlbConfig config;
+    Cache* cache;
+    cache_stats_t* stats;
+    cache_stats_t walk_stats = {};
+
+    TlbArray l1, l2, pwc;
+    u64 l2_lookups = 0;
+
+    // PAGES_THP: 4K pages touched per 2M region, and promoted regions
+    std::unordered_set<u64> touched;
+    std::unordered_map<u64, u64> region_pages;
+    std::unordered_set<u64> huge;
+
+    // Page table level of the leaf entry for `addr` (3 = 4K, 2 = 2M, 1 = 1G)
+    int leaf_level(u64 addr);
+
+    void promote(u64 region);
+    void walk(u64 addr, int leaf);
+};
+
+#endif
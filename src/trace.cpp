@@ -0,0 +1,162 @@
+#include "trace.hpp"
+#include "util.hpp" // exit_on_error
+
+TraceReader::TraceReader(std::istream* is) : is(is) {
+    // Reduced traces open with their block size
+    if ((*is >> std::ws).peek() == 'b') {
+        char mode;
+
+        if (!(*is >> mode >> std::hex >> reduced_B) || reduced_B == 0)
+            exit_on_error("Invalid input file format");
+    }
+}
+
+// Parse another hex number on the current line; false at end of line
+static bool next_field(std::istream& is, u64& value) {
+    // Straight from the buffer: peek() costs a sentry per call
+    std::streambuf* buf = is.rdbuf();
+    int c;
+
+    while ((c = buf->sgetc()) == ' ' || c == '\t' || c == '\r')
+        buf->sbumpc();
+
+    if (c == '\n' || c == EOF)
+        return false;
+
+    if (!(is >> value))
+        exit_on_error("Invalid input file format");
+
+    return true;
+}
+
+bool TraceReader::next(Access& a) {
+    char mode;
+    u64 address;
+
+    if (!(*is >> mode >> std::hex >> address))
+        return false;
+
+    switch (mode) {
+        case REPEAT: {
+            u64 writes;
+
+            if (reduced_B == 0 || !(*is >> writes) || address > REPEAT_MAX || writes > REPEAT_MAX)
+                exit_on_error("Invalid input file format");
+
+            a = make_repeat(address, writes);
+            return true;
+        }
+        case 'r':
+        case 'R':
+            a.mode = READ;
+            break;
+        case 'w':
+        case 'W':
+            a.mode = WRITE;
+            break;
+        default:
+            exit_on_error("Invalid input file format");
+    }
+
+    a.addr = address;
+
+    // Optional PC and size
+    u64 pc = 0, size = 0;
+
+    if (next_field(*is, pc))
+        next_field(*is, size);
+
+    if (size > 0xffff)
+        exit_on_error("Invalid input file format");
+
+    a.pc = static_cast<uint32_t>(pc);
+    a.size = static_cast<uint16_t>(size);
+
+    return true;
+}
+
+size_t TraceReader::next_batch(Access* out, size_t n) {
+    size_t i = 0;
+
+    while (i < n && next(out[i]))
+        i++;
+
+    return i;
+}
+
+void TraceReader::read_all(std::vector<Access>& out) {
+    Access a;
+
+    while (next(a))
+        out.push_back(a);
+}
+
+void TraceReducer::push(const Access& a, std::vector<Access>& out) {
+    u64 b = a.addr >> B;
+    u64 offset = a.addr & ((static_cast<u64>(1) << B) - 1);
+
+    // Only the first block of a spanning access would be kept
+    if (a.size > 1 && offset + a.size > (static_cast<u64>(1) << B))
+        exit_on_error("Accesses spanning blocks cannot be reduced.");
+
+    if (open && b == block && offset >= min_offset) {
+        if (a.mode == WRITE)
+            writes++;
+        else
+            reads++;
+
+        if (reads == REPEAT_MAX || writes == REPEAT_MAX)
+            flush(out);
+
+        return;
+    }
+
+    flush(out);
+    out.push_back(a);
+
+    // A lower offset in the same block only extends the valid suffix
+    open = true;
+    block = b;
+    min_offset = offset;
+}
+
+void TraceReducer::flush(std::vector<Access>& out) {
+    if (reads + writes == 0)
+        return;
+
+    out.push_back(make_repeat(reads, writes));
+    reads = writes = 0;
+}
+
+void reduce_trace(const std::vector<Access>& in, u64 B, std::vector<Access>& out) {
+    TraceReducer reducer(B);
+
+    for (auto& a: in)
+        reducer.push(a, out);
+
+    reducer.flush(out);
+}
+
+void write_record(std::ostream& os, const Access& a) {
+    os << a.mode << " 0x" << std::hex << a.addr;
+
+    if (a.pc != 0 || a.size != 0)
+        os << " 0x" << a.pc;
+    if (a.size != 0)
+        os << " " << a.size;
+
+    os << "\n";
+}
+
+void write_reduced(std::ostream& os, const std::vector<Access>& records, u64 B) {
+    os << std::hex << "b " << B << "\n";
+
+    for (auto& a: records) {
+        if (a.mode == REPEAT)
+            os << "h " << repeat_reads(a) << " " << repeat_writes(a) << "\n";
+        else
+            write_record(os, a);
+    }
+
+    os << std::dec;
+}
@@ -0,0 +1,97 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "cachesim.hpp"
+
+// Records decoded per batch (16 KB, stays in the host L1)
+static const size_t ACCESS_BATCH = 1024;
+
+/**
+    Anything that produces a stream of accesses (trace files, generators).
+*/
+class AccessSource {
+public:
+    virtual ~AccessSource() {}
+
+    // Produce the next record; false at end of stream
+    virtual bool next(Access& a) = 0;
+
+    // Produce up to `n` records into `out`; returns number produced
+    virtual size_t next_batch(Access* out, size_t n) = 0;
+};
+
+/**
+    Decodes a text trace (`r <addr>` / `w <addr>` per line) from a stream.
+    Records may add the PC and the access size: `r <addr> <pc> <size>`
+    (hex, like the address; either may be left out from the right).
+
+    Reduced traces (see TraceReducer) start with a `b <B>` line and may
+    contain `h <reads> <writes>` repeat records; all numbers are hex.
+*/
+class TraceReader : public AccessSource {
+public:
+    TraceReader(std::istream* is);
+
+    // Decode the next record; false at end of trace
+    // Exits on malformed records
+    bool next(Access& a) override;
+
+    // Decode up to `n` records into `out`; returns number decoded
+    size_t next_batch(Access* out, size_t n) override;
+
+    // Decode the whole (remaining) trace
+    void read_all(std::vector<Access>& out);
+
+    // Block size (log2) a reduced trace was made for; 0 = not reduced
+    u64 block_bits() const { return reduced_B; }
+
+private:
+    std::istream* is;
+    u64 reduced_B = 0;
+};
+
+/**
+    Lossless trace reduction for LRU caches with blocks of at least 2^B bytes.
+
+    After an access at offset `o`, its block is MRU and every subblock from
+    `o` to the end of the block is valid (fills always fetch that suffix).
+    Until an access to another block, further accesses at offsets >= the
+    smallest offset seen are therefore hits that change nothing but the
+    counters and the dirty bit. Such runs are collapsed into one REPEAT
+    record after the access that opened them.
+
+    This holds for any C, S, K and V, and for larger blocks too, but only
+    for write-back, write-allocate caches without prefetching or timing.
+*/
+class TraceReducer {
+public:
+    TraceReducer(u64 B) : B(B) {}
+
+    // Reduce one access; appends any records it completes to `out`
+    void push(const Access& a, std::vector<Access>& out);
+
+    // Emit the pending repeat record (at end of trace)
+    void flush(std::vector<Access>& out);
+
+private:
+    u64 B;
+    bool open = false;    // A block has been seen
+    u64 block = 0;        // Block of the last emitted access
+    u64 min_offset = 0;   // Valid subblocks start at or below this
+    u64 reads = 0, writes = 0;
+};
+
+// Reduce a whole trace for blocks of 2^B bytes
+void reduce_trace(const std::vector<Access>& in, u64 B, std::vector<Access>& out);
+
+// Write one read or write record in the text format (hex, with any PC/size)
+void write_record(std::ostream& os, const Access& a);
+
+// Write a reduced trace in the text format TraceReader decodes
+void write_reduced(std::ostream& os, const std::vector<Access>& records, u64 B);
+
+#endif
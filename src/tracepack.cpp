@@ -0,0 +1,91 @@
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "chunktrace.hpp"
+#include "trace.hpp"
+#include "util.hpp" // exit_on_error
+
+// C includes
+#include <unistd.h>
+
+/**
+    Converts a text trace (plain or reduced) into a chunked trace, or with
+    -d a chunked trace back into text.
+*/
+static void usage() {
+    exit_on_error("Usage: tracepack [-c chunk_records] [-i trace] -o chunked | tracepack -d -i chunked");
+}
+
+int main(int argc, char **argv) {
+    u64 chunk_records = DEFAULT_CHUNK_RECORDS;
+    std::string in_name, out_name;
+    bool unpack = false;
+    int c;
+
+    while ((c = getopt(argc, argv, "c:i:o:d")) != -1) {
+        switch (c) {
+            case 'c':
+                chunk_records = parse_size(optarg, 1024);
+                break;
+            case 'i':
+                in_name = optarg;
+                break;
+            case 'o':
+                out_name = optarg;
+                break;
+            case 'd':
+                unpack = true;
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (unpack) {
+        if (in_name.empty())
+            usage();
+
+        ChunkedTrace trace(in_name);
+        std::vector<Access> records;
+        trace.read(0, trace.records(), records);
+
+        if (trace.block_bits() > 0) {
+            write_reduced(std::cout, records, trace.block_bits());
+        } else {
+            std::cout << std::hex;
+
+            for (auto& a: records)
+                write_record(std::cout, a);
+        }
+
+        return 0;
+    }
+
+    if (out_name.empty())
+        usage();
+
+    std::ifstream ifs;
+    std::istream* is = &std::cin;
+
+    if (!in_name.empty()) {
+        ifs.open(in_name);
+
+        if (!ifs.good())
+            exit_on_error("File not found.");
+
+        is = &ifs;
+    }
+
+    TraceReader reader(is);
+    ChunkedTraceWriter writer(out_name, chunk_records, reader.block_bits());
+    Access a;
+
+    while (reader.next(a))
+        writer.push(a);
+
+    writer.close();
+
+    return 0;
+}
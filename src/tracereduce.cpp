@@ -0,0 +1,79 @@
+#include <cstdlib>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "trace.hpp"
+#include "util.hpp" // exit_on_error
+
+// C includes
+#include <unistd.h>
+
+/**
+    Writes a reduced copy of a trace (see TraceReducer) that cachesim and
+    cacheopt replay with identical statistics for any cache with blocks of
+    at least 2^B bytes.
+*/
+int main(int argc, char **argv) {
+    u64 B = 0;
+    std::string in_name, out_name;
+    int c;
+
+    while ((c = getopt(argc, argv, "B:i:o:")) != -1) {
+        switch (c) {
+            case 'B':
+                B = strtol(optarg, NULL, 10);
+                break;
+            case 'i':
+                in_name = optarg;
+                break;
+            case 'o':
+                out_name = optarg;
+                break;
+            default:
+                exit_on_error("Usage: tracereduce -B block_bits [-i trace] [-o reduced]");
+        }
+    }
+
+    if (B == 0 || B > 32)
+        exit_on_error("Usage: tracereduce -B block_bits [-i trace] [-o reduced]");
+
+    std::ifstream ifs;
+    std::istream* is = &std::cin;
+
+    if (!in_name.empty()) {
+        ifs.open(in_name);
+
+        if (!ifs.good())
+            exit_on_error("File not found.");
+
+        is = &ifs;
+    }
+
+    std::vector<Access> trace, reduced;
+    TraceReader reader(is);
+
+    if (reader.block_bits() != 0)
+        exit_on_error("Trace is already reduced.");
+
+    reader.read_all(trace);
+    reduce_trace(trace, B, reduced);
+
+    std::ofstream ofs;
+    std::ostream* os = &std::cout;
+
+    if (!out_name.empty()) {
+        ofs.open(out_name);
+
+        if (!ofs.good())
+            exit_on_error("Could not open output file.");
+
+        os = &ofs;
+    }
+
+    write_reduced(*os, reduced, B);
+
+    std::cerr << trace.size() << " accesses -> " << reduced.size() << " records" << std::endl;
+
+    return 0;
+}
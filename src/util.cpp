@@ -1,8 +1,78 @@
+#include <cstdlib>
 #include <iostream>
 
 #include "util.hpp"
 
+static ErrorHandler error_handler = nullptr;
+
+void set_error_handler(ErrorHandler handler) {
+    error_handler = handler;
+}
+
 void exit_on_error(std::string msg) {
+    if (error_handler != nullptr)
+        error_handler(msg);
+
     std::cout << "Error: " << msg << std::endl;
     exit(EXIT_FAILURE);
 }
+
+std::string parse_spec(const std::string& spec, SpecOptions& opts) {
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+
+    if (colon == std::string::npos)
+        return kind;
+
+    // key=value pairs separated by commas
+    std::string rest = spec.substr(colon + 1);
+    size_t pos = 0;
+
+    while (pos < rest.size()) {
+        size_t comma = rest.find(',', pos);
+        if (comma == std::string::npos)
+            comma = rest.size();
+
+        std::string kv = rest.substr(pos, comma - pos);
+        size_t eq = kv.find('=');
+
+        if (eq == std::string::npos)
+            exit_on_error("Invalid option: " + kv);
+
+        opts.push_back(std::make_pair(kv.substr(0, eq), kv.substr(eq + 1)));
+        pos = comma + 1;
+    }
+
+    return kind;
+}
+
+u64 parse_size(const std::string& s, u64 unit) {
+    char* end;
+    u64 v = strtoull(s.c_str(), &end, 0);
+
+    switch (*end) {
+        case 'k': case 'K': v *= unit; break;
+        case 'm': case 'M': v *= unit * unit; break;
+        case 'g': case 'G': v *= unit * unit * unit; break;
+        case '\0': break;
+        default:
+            exit_on_error("Invalid value: " + s);
+    }
+
+    if (end == s.c_str())
+        exit_on_error("Invalid value: " + s);
+
+    return v;
+}
+
+u64 parse_log2(const std::string& s, u64 lo, const std::string& name) {
+    char* end;
+    u64 v = strtoull(s.c_str(), &end, 10);
+
+    if (end == s.c_str() || *end != '\0')
+        exit_on_error("Invalid value: " + s);
+    if (v < lo || v > 63)
+        exit_on_error(name + " must be between " + std::to_string(lo) + " and 63 (log2 bytes).");
+
+    return v;
+}
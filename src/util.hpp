@@ -2,7 +2,28 @@
 #define UTIL_H
 
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "cachesim.hpp"
 
 void exit_on_error(std::string msg);
 
+// Called by exit_on_error() instead of exiting when set (the library
+// installs one that throws, so errors never end the host process)
+typedef void (*ErrorHandler)(const std::string& msg);
+void set_error_handler(ErrorHandler handler);
+
+// Options of a "kind:key=value,..." spec, in order
+typedef std::vector<std::pair<std::string, std::string>> SpecOptions;
+
+// Split a spec into its kind (returned) and key/value options
+std::string parse_spec(const std::string& spec, SpecOptions& opts);
+
+// Parse an integer with an optional K/M/G suffix (multiples of `unit`)
+u64 parse_size(const std::string& s, u64 unit);
+
+// Parse a plain log2 size (address bits) in [lo, 63]; `name` for errors
+u64 parse_log2(const std::string& s, u64 lo, const std::string& name);
+
 #endif
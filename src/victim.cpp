@@ -30,23 +30,24 @@ Block* VictimCache::remove(const int pos) {
     return temp;
 }
 
-void VictimCache::push(const Block* block, cache_stats_t* stats) {
+bool VictimCache::push(const Block* block, Block& spill) {
     // Push block to front of queue
     // Vector will make a copy of the block passed in
     queue.push_front(*block);
 
     // Perform eviction, if required
     if (queue.size() > V) {
-        Block& out_block = queue[V];
-
-        // Writeback if target is dirty
-        if (out_block.dirty) {
-            // Write back valid subblocks to memory
-            int num_valid = out_block.num_valid();
-            stats->bytes_transferred += num_valid;
-            stats->write_backs++;
-        }
-
+        spill = queue[V];
         queue.pop_back();
+        return true;
     }
+
+    return false;
+}
+
+void VictimCache::save_state(std::vector<u64>& out) const {
+    out.push_back(queue.size());
+
+    for (auto& block: queue)
+        block.save_state(out);
 }
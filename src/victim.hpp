@@ -17,10 +17,12 @@ public:
     Block* remove(const int pos);
 
     // Push a block onto VC
-    // Remove last if size > V
-    // stats* required to update write_backs
-    // K required to know size of subblock
-    void push(const Block* block, cache_stats_t* stats);
+    // Remove last if size > V, copying it to `spill`
+    // Returns true if a block was spilled (caller handles writeback)
+    bool push(const Block* block, Block& spill);
+
+    // Append the queued blocks, newest first
+    void save_state(std::vector<u64>& out) const;
 private:
     u64 V; // Number of blocks
     std::deque<Block> queue;
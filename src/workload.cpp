@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "workload.hpp"
+#include "util.hpp" // exit_on_error
+
+void Rng::seed(u64 s) {
+    // splitmix64 scrambles the seed; state must be non-zero
+    s += 0x9e3779b97f4a7c15ULL;
+    s = (s ^ (s >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    s = (s ^ (s >> 27)) * 0x94d049bb133111ebULL;
+    state = s ^ (s >> 31);
+
+    if (state == 0)
+        state = 1;
+}
+
+Workload::Workload(const WorkloadParams& p) : p(p), rng(p.seed) {
+    if (p.footprint == 0 || p.gran == 0 || p.stride == 0)
+        exit_on_error("Workload footprint, gran and stride must be positive.");
+    if (p.writes < 0 || p.writes > 1)
+        exit_on_error("Workload write fraction must be in [0, 1].");
+}
+
+void Workload::reset() {
+    rng.seed(p.seed);
+    produced = 0;
+}
+
+bool Workload::next(Access& a) {
+    if (produced == p.count)
+        return false;
+
+    a.addr = next_addr();
+    a.mode = rng.uniform() < p.writes ? WRITE : READ;
+    a.size = 0;
+    a.pc = 0;
+    produced++;
+
+    return true;
+}
+
+size_t Workload::next_batch(Access* out, size_t n) {
+    size_t i = 0;
+
+    while (i < n && next(out[i]))
+        i++;
+
+    return i;
+}
+
+void StridedWorkload::reset() {
+    Workload::reset();
+    pos = 0;
+}
+
+u64 StridedWorkload::next_addr() {
+    u64 addr = p.base + pos;
+
+    pos += p.stride;
+    if (pos >= p.footprint)
+        pos = 0;
+
+    return addr;
+}
+
+UniformWorkload::UniformWorkload(const WorkloadParams& p) : Workload(p) {
+    if (p.gran == 0 || p.footprint / p.gran == 0)
+        exit_on_error("Uniform footprint must hold at least one item.");
+}
+
+u64 UniformWorkload::next_addr() {
+    return p.base + rng.below(p.footprint / p.gran) * p.gran;
+}
+
+/*
+    Zipf sampling by rejection-inversion (Hoermann & Derflinger),
+    O(1) time and memory per sample regardless of the number of items.
+*/
+static double helper1(double x) {
+    return std::fabs(x) > 1e-8 ? std::log1p(x) / x : 1 - x * (0.5 - x * (1.0 / 3 - 0.25 * x));
+}
+
+static double helper2(double x) {
+    return std::fabs(x) > 1e-8 ? std::expm1(x) / x : 1 + x * 0.5 * (1 + x * (1.0 / 3) * (1 + 0.25 * x));
+}
+
+double ZipfWorkload::h(double x) {
+    return std::exp(-p.alpha * std::log(x));
+}
+
+double ZipfWorkload::h_integral(double x) {
+    double log_x = std::log(x);
+    return helper2((1 - p.alpha) * log_x) * log_x;
+}
+
+double ZipfWorkload::h_integral_inverse(double x) {
+    double t = x * (1 - p.alpha);
+    if (t < -1)
+        t = -1;
+    return std::exp(helper1(t) * x);
+}
+
+ZipfWorkload::ZipfWorkload(const WorkloadParams& p) : Workload(p) {
+    items = p.footprint / p.gran;
+
+    if (items == 0)
+        exit_on_error("Zipf footprint must hold at least one item.");
+    if (p.alpha < 0)
+        exit_on_error("Zipf alpha must be non-negative.");
+
+    // Scatter ranks with an odd multiplier mod 2^k (a bijection)
+    mask = 1;
+    while (mask < items)
+        mask <<= 1;
+    mask--;
+
+    h_x1 = h_integral(1.5) - 1;
+    h_n = h_integral(items + 0.5);
+    s = 2 - h_integral_inverse(h_integral(2.5) - h(2));
+}
+
+u64 ZipfWorkload::next_addr() {
+    u64 rank;
+
+    // Rank in [1, items]; rank 1 is the hottest
+    while (true) {
+        double u = h_n + rng.uniform() * (h_x1 - h_n);
+        double x = h_integral_inverse(u);
+        double k = std::floor(x + 0.5);
+
+        if (k < 1)
+            k = 1;
+        else if (k > items)
+            k = static_cast<double>(items);
+
+        if (k - x <= s || u >= h_integral(k + 0.5) - h(k)) {
+            rank = static_cast<u64>(k) - 1;
+            break;
+        }
+    }
+
+    // Hot ranks land in different sets; cycle-walk past slots beyond the footprint
+    u64 slot = rank;
+    do {
+        slot = (slot * 0x9e3779b97f4a7c15ULL) & mask;
+    } while (slot >= items);
+
+    return p.base + slot * p.gran;
+}
+
+PointerChaseWorkload::PointerChaseWorkload(const WorkloadParams& p) : Workload(p) {
+    u64 items = p.footprint / p.gran;
+
+    if (items == 0)
+        exit_on_error("Pointer chase footprint must hold at least one item.");
+
+    // Sattolo's algorithm: a random permutation with a single cycle
+    Rng perm_rng(p.seed ^ 0x5bd1e995ULL);
+    succ.resize(items);
+
+    for (u64 i = 0; i < items; i++)
+        succ[i] = i;
+
+    for (u64 i = items - 1; i > 0; i--)
+        std::swap(succ[i], succ[perm_rng.below(i)]);
+}
+
+void PointerChaseWorkload::reset() {
+    Workload::reset();
+    cur = 0;
+}
+
+u64 PointerChaseWorkload::next_addr() {
+    u64 addr = p.base + cur * p.gran;
+    cur = succ[cur];
+    return addr;
+}
+
+WorkloadParams parse_workload(const std::string& spec) {
+    WorkloadParams p;
+
+    SpecOptions opts;
+    std::string kind = parse_spec(spec, opts);
+
+    if (kind == "seq") {
+        p.kind = WL_SEQUENTIAL;
+        p.stride = 8;
+    } else if (kind == "stride") {
+        p.kind = WL_STRIDED;
+    } else if (kind == "uniform") {
+        p.kind = WL_UNIFORM;
+    } else if (kind == "zipf") {
+        p.kind = WL_ZIPF;
+    } else if (kind == "chase") {
+        p.kind = WL_POINTER_CHASE;
+    } else {
+        exit_on_error("Unknown workload: " + kind);
+    }
+
+    for (auto& kv: opts) {
+        const std::string& key = kv.first;
+        const std::string& val = kv.second;
+
+        if (key == "n")
+            p.count = parse_size(val, 1000);
+        else if (key == "seed")
+            p.seed = parse_size(val, 1000);
+        else if (key == "writes")
+            p.writes = atof(val.c_str());
+        else if (key == "base")
+            p.base = parse_size(val, 1024);
+        else if (key == "footprint")
+            p.footprint = parse_size(val, 1024);
+        else if (key == "stride")
+            p.stride = parse_size(val, 1024);
+        else if (key == "gran")
+            p.gran = parse_size(val, 1024);
+        else if (key == "alpha")
+            p.alpha = atof(val.c_str());
+        else
+            exit_on_error("Unknown workload option: " + key);
+    }
+
+    return p;
+}
+
+Workload* make_workload(const WorkloadParams& p) {
+    switch (p.kind) {
+        case WL_SEQUENTIAL:
+        case WL_STRIDED:
+            return new StridedWorkload(p);
+        case WL_UNIFORM:
+            return new UniformWorkload(p);
+        case WL_ZIPF:
+            return new ZipfWorkload(p);
+        case WL_POINTER_CHASE:
+            return new PointerChaseWorkload(p);
+    }
+
+    return nullptr;
+}
@@ -0,0 +1,140 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <string>
+#include <vector>
+
+#include "cachesim.hpp"
+#include "trace.hpp"
+
+/**
+    Small, fast, seedable PRNG (xorshift64*).
+*/
+class Rng {
+public:
+    Rng(u64 seed) { this->seed(seed); }
+
+    void seed(u64 s);
+
+    inline u64 next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545f4914f6cdd1dULL;
+    }
+
+    // Uniform in [0, n)
+    inline u64 below(u64 n) {
+        return next() % n;
+    }
+
+    // Uniform in [0, 1)
+    inline double uniform() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+private:
+    u64 state;
+};
+
+enum WorkloadKind {
+    WL_SEQUENTIAL,
+    WL_STRIDED,
+    WL_UNIFORM,
+    WL_ZIPF,
+    WL_POINTER_CHASE
+};
+
+/**
+    Parameters shared by all generators.
+    Parsed from "kind:key=value,..." (see parse_workload()).
+*/
+struct WorkloadParams {
+    WorkloadKind kind;
+    u64 count = 1000000;     // Accesses to produce (n)
+    u64 seed = 1;            // PRNG seed (seed)
+    double writes = 0.25;    // Fraction of writes (writes)
+    u64 base = 0x10000000;   // First address (base)
+    u64 footprint = 1 << 20; // Bytes touched (footprint)
+    u64 stride = 64;         // Bytes between strided accesses (stride)
+    u64 gran = 64;           // Item size for random/zipf/chase (gran)
+    double alpha = 0.99;     // Zipf skew (alpha)
+};
+
+/**
+    Generates an access stream in memory, without touching disk.
+    The stream is a pure function of the parameters, so runs are reproducible.
+*/
+class Workload : public AccessSource {
+public:
+    Workload(const WorkloadParams& p);
+    virtual ~Workload() {}
+
+    bool next(Access& a) override;
+    size_t next_batch(Access* out, size_t n) override;
+
+    // Restart the stream from the beginning
+    virtual void reset();
+
+    const WorkloadParams& params() const { return p; }
+
+protected:
+    WorkloadParams p;
+    Rng rng;
+    u64 produced = 0;
+
+    // Address of the next access
+    virtual u64 next_addr() = 0;
+};
+
+// Sequential and strided scans over the footprint (wraps around)
+class StridedWorkload : public Workload {
+public:
+    StridedWorkload(const WorkloadParams& p) : Workload(p) {}
+    void reset() override;
+protected:
+    u64 pos = 0;
+    u64 next_addr() override;
+};
+
+// Uniformly random items in the footprint
+class UniformWorkload : public Workload {
+public:
+    UniformWorkload(const WorkloadParams& p);
+protected:
+    u64 next_addr() override;
+};
+
+// Zipf-distributed item popularity; hot items scattered through the footprint
+class ZipfWorkload : public Workload {
+public:
+    ZipfWorkload(const WorkloadParams& p);
+protected:
+    u64 items, mask;
+    double h_x1, h_n, s; // Sampler constants
+    u64 next_addr() override;
+
+    double h(double x);
+    double h_integral(double x);
+    double h_integral_inverse(double x);
+};
+
+// Dependent walk along a single random cycle through all items
+class PointerChaseWorkload : public Workload {
+public:
+    PointerChaseWorkload(const WorkloadParams& p);
+    void reset() override;
+protected:
+    std::vector<u64> succ;
+    u64 cur = 0;
+    u64 next_addr() override;
+};
+
+// Parse "kind[:key=value,...]", e.g. "zipf:n=10M,alpha=0.9,writes=0.3"
+// Kinds: seq, stride, uniform, zipf, chase. Sizes accept K/M/G suffixes.
+WorkloadParams parse_workload(const std::string& spec);
+
+// Construct the generator for `p` (caller owns)
+Workload* make_workload(const WorkloadParams& p);
+
+#endif
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "writebuf.hpp"
+#include "util.hpp" // exit_on_error
+
+WriteBuffer::WriteBuffer(int entries, double drain, u64 B, u64 K, cache_stats_t* stats) :
+            ring(entries), drain_cycles(drain), B(B), K(K), stats(stats) {
+    if (entries <= 0)
+        exit_on_error("Write buffer needs at least one entry.");
+
+    // One mask bit per subblock
+    size_t words = ((static_cast<size_t>(1) << (B - K)) + 63) / 64;
+
+    for (auto& e: ring)
+        e.mask.resize(words, 0);
+}
+
+int WriteBuffer::mark(std::vector<u64>& mask, int first, int last) {
+    int added = 0;
+
+    for (int i = first; i <= last; i++) {
+        u64 bit = static_cast<u64>(1) << (i % 64);
+
+        if (!(mask[i / 64] & bit)) {
+            mask[i / 64] |= bit;
+            added++;
+        }
+    }
+
+    return added;
+}
+
+void WriteBuffer::pop() {
+    head = (head + 1) % ring.size();
+    count--;
+
+    // Next entry has been waiting; it starts as soon as the head is done
+    if (count > 0)
+        head_done += drain_cycles;
+}
+
+void WriteBuffer::drain(double now) {
+    while (count > 0 && head_done <= now)
+        pop();
+}
+
+double WriteBuffer::write(u64 block_addr, int first, int last, double now) {
+    drain(now);
+
+    // Coalesce into a buffered write to the same block
+    for (int i = 0; i < count; i++) {
+        Entry& e = ring[(head + i) % ring.size()];
+
+        if (e.block == block_addr) {
+            int added = mark(e.mask, first, last);
+            stats->bytes_transferred += static_cast<u64>(added) << K;
+            stats->wbuf_coalesced++;
+            return 0;
+        }
+    }
+
+    double stall = 0;
+
+    // Full: wait for the head to retire
+    if (count == static_cast<int>(ring.size())) {
+        stall = head_done - now;
+        pop();
+
+        stats->wbuf_stalls++;
+    }
+
+    if (count == 0)
+        head_done = now + stall + drain_cycles;
+
+    Entry& e = ring[(head + count) % ring.size()];
+    e.block = block_addr;
+    std::fill(e.mask.begin(), e.mask.end(), 0);
+
+    int added = mark(e.mask, first, last);
+    stats->bytes_transferred += static_cast<u64>(added) << K;
+    stats->wbuf_writes++;
+    count++;
+
+    return stall;
+}
+
+WriteConfig parse_write_config(const std::string& spec) {
+    WriteConfig wc;
+    SpecOptions opts;
+    std::string kind = parse_spec(spec, opts);
+
+    if (kind == "wb")
+        wc.policy = WRITE_BACK;
+    else if (kind == "wt")
+        wc.policy = WRITE_THROUGH;
+    else if (kind == "nwa")
+        wc.policy = WRITE_NO_ALLOCATE;
+    else
+        exit_on_error("Unknown write policy: " + kind);
+
+    for (auto& kv: opts) {
+        if (kv.first == "buffer")
+            wc.buffer = static_cast<int>(parse_size(kv.second, 1024));
+        else if (kv.first == "drain")
+            wc.drain = atof(kv.second.c_str());
+        else
+            exit_on_error("Unknown write policy option: " + kv.first);
+    }
+
+    if (wc.drain < 0)
+        exit_on_error("Write buffer drain time must be non-negative.");
+
+    return wc;
+}
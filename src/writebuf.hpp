@@ -0,0 +1,72 @@
+#ifndef WRITEBUF_H
+#define WRITEBUF_H
+
+#include <string>
+#include <vector>
+
+#include "cachesim.hpp"
+
+enum WritePolicy {
+    WRITE_BACK,        // Write-back, write-allocate (default)
+    WRITE_THROUGH,     // Write-through, write-allocate
+    WRITE_NO_ALLOCATE  // Write-through, no-write-allocate
+};
+
+struct WriteConfig {
+    WritePolicy policy = WRITE_BACK;
+    int buffer = 0;     // Write buffer entries (0 = none)
+    double drain = 10;  // Cycles to retire one entry
+};
+
+// Parse "wb|wt|nwa[:buffer=N,drain=D]"
+WriteConfig parse_write_config(const std::string& spec);
+
+/**
+    Finite coalescing write buffer between the cache and memory.
+
+    Entries hold one block each (with a mask of written subblocks) and
+    retire to memory in FIFO order, one every `drain` cycles. A write to a
+    block already buffered coalesces into its entry. A write that needs a
+    new entry while the buffer is full stalls until the head retires.
+
+    Bytes are charged to bytes_transferred when first buffered, so
+    coalesced writes only cost the subblocks they add.
+*/
+class WriteBuffer {
+public:
+    WriteBuffer(int entries, double drain, u64 B, u64 K, cache_stats_t* stats);
+
+    // Buffer a write of subblocks [first, last] of a block at time `now`
+    // Returns the cycles the cache stalls waiting for a free entry
+    double write(u64 block_addr, int first, int last, double now);
+
+    // Retire every entry finished by `now`
+    void drain(double now);
+
+    // Record current occupancy (once per access)
+    inline void sample() {
+        stats->wbuf_occupancy_sum += count;
+        if (static_cast<u64>(count) > stats->wbuf_max_occupancy)
+            stats->wbuf_max_occupancy = count;
+    }
+
+private:
+    struct Entry {
+        u64 block;
+        std::vector<u64> mask; // Written subblocks
+    };
+
+    std::vector<Entry> ring;
+    int head = 0, count = 0;
+    double drain_cycles;
+    double head_done = 0; // Time the head entry finishes retiring
+
+    u64 B, K;
+    cache_stats_t* stats;
+
+    void pop();
+    // Set bits [first, last] in `mask`; returns how many were newly set
+    int mark(std::vector<u64>& mask, int first, int last);
+};
+
+#endif